@@ -0,0 +1,564 @@
+// smarttodo_bench: times every ToDoList operation over synthetic task sets.
+//
+// Usage: smarttodo_bench [--min N] [--max N] [--seed S] [--json FILE] [--dir DIR]
+//                        [--threads N]
+// Sizes run in powers of ten from --min (default 1e3) to --max (default 1e7). Results
+// print as a table and, with --json, as a machine-readable file for diffing runs. The
+// contention runs double the thread count from 1 to --threads (default 32).
+
+#include "../include/batch.h"
+#include "../include/concurrent_todo.h"
+#include "../include/external_todo.h"
+#include "../include/list_manager.h"
+#include "../include/metrics.h"
+#include "../include/reminder_scheduler.h"
+#include "../include/task_server.h"
+#include "../include/todo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+struct Result {
+    std::string op;
+    std::size_t tasks;
+    std::size_t ops;
+    std::uint64_t totalNs;
+    long peakRssKb;
+    double bytesPerTask; // ToDoList::memoryUsage() / size() after the op; 0 if not measured
+};
+
+struct Options {
+    std::size_t minTasks = 1000;
+    std::size_t maxTasks = 10000000;
+    std::uint64_t seed = 42;
+    std::string jsonPath;
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::size_t maxThreads = 32;
+    std::size_t externalBudgetMb = 0; // --external: only the out-of-core list, with this budget
+};
+
+// Process-wide high-water mark; sizes run in ascending order so each row reflects
+// the largest footprint reached so far.
+long peakRssKb() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+std::vector<smarttodo::NewTask> generateTasks(std::size_t n, std::uint64_t seed) {
+    static const char* const words[] = {"review", "invoice", "call",   "draft",  "report",
+                                        "fix",    "deploy",  "email",  "plan",   "meeting",
+                                        "update", "budget",  "client", "backup", "notes"};
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> prio(1, 5);
+    std::uniform_int_distribution<int> wordCount(2, 8);
+    std::uniform_int_distribution<int> word(0, sizeof(words) / sizeof(words[0]) - 1);
+    std::uniform_int_distribution<int> dueOffsetMin(-30 * 24 * 60, 30 * 24 * 60);
+    std::bernoulli_distribution hasDue(0.5);
+
+    std::time_t now = std::time(nullptr);
+    std::vector<smarttodo::NewTask> specs;
+    specs.reserve(n);
+    char buf[32];
+    for (std::size_t i = 0; i < n; ++i) {
+        smarttodo::NewTask s;
+        s.priority = prio(rng);
+        int count = wordCount(rng);
+        for (int w = 0; w < count; ++w) {
+            if (w) s.description += ' ';
+            s.description += words[word(rng)];
+        }
+        s.description += " ref " + std::to_string(100000 + i % 900000); // what search looks up
+        if (hasDue(rng)) {
+            std::time_t due = now + static_cast<std::time_t>(dueOffsetMin(rng)) * 60;
+            std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", std::localtime(&due));
+            s.dueDate = buf;
+        }
+        specs.push_back(std::move(s));
+    }
+    return specs;
+}
+
+class Bench {
+public:
+    // Pass `list` to also report the footprint it has after the op.
+    template <typename Fn, typename List = smarttodo::ToDoList>
+    void run(const std::string& op, std::size_t tasks, std::size_t ops, Fn&& fn, const List* list = nullptr) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        Result r{op, tasks, ops,
+                 static_cast<std::uint64_t>(
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()),
+                 peakRssKb(),
+                 list && list->size() ? static_cast<double>(list->memoryUsage()) / list->size()
+                                      : 0.0};
+        print(r);
+        results_.push_back(r);
+    }
+
+    void printHeader() const {
+        std::cout << std::left << std::setw(20) << "op" << std::right << std::setw(10) << "tasks"
+                  << std::setw(14) << "ns/op" << std::setw(16) << "ops/s" << std::setw(14)
+                  << "peak RSS KB" << std::setw(12) << "bytes/task" << '\n';
+    }
+
+    bool writeJson(const std::string& path, const Options& opts) const {
+        std::ofstream file(path);
+        if (!file) return false;
+        file << "{\n  \"benchmark\": \"smarttodo_bench\",\n  \"seed\": " << opts.seed
+             << ",\n  \"results\": [\n";
+        for (std::size_t i = 0; i < results_.size(); ++i) {
+            const Result& r = results_[i];
+            file << "    {\"op\": \"" << r.op << "\", \"tasks\": " << r.tasks
+                 << ", \"ops\": " << r.ops << ", \"total_ns\": " << r.totalNs
+                 << ", \"ns_per_op\": " << nsPerOp(r) << ", \"ops_per_sec\": " << opsPerSec(r)
+                 << ", \"peak_rss_kb\": " << r.peakRssKb
+                 << ", \"bytes_per_task\": " << r.bytesPerTask << "}"
+                 << (i + 1 < results_.size() ? ",\n" : "\n");
+        }
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+private:
+    static double nsPerOp(const Result& r) {
+        return r.ops ? static_cast<double>(r.totalNs) / r.ops : 0.0;
+    }
+
+    static double opsPerSec(const Result& r) {
+        return r.totalNs ? r.ops * 1e9 / static_cast<double>(r.totalNs) : 0.0;
+    }
+
+    static void print(const Result& r) {
+        std::cout << std::left << std::setw(20) << r.op << std::right << std::setw(10) << r.tasks
+                  << std::setw(14) << std::fixed << std::setprecision(1) << nsPerOp(r)
+                  << std::setw(16) << std::setprecision(0) << opsPerSec(r) << std::setw(14)
+                  << r.peakRssKb << std::setw(12) << std::setprecision(1) << r.bytesPerTask
+                  << std::endl;
+    }
+
+    std::vector<Result> results_;
+};
+
+// One queue-bound workload per backend, so the rows compare the general heap with the
+// 1-5 buckets: inserts, a full priority-order walk, updates in random order, then
+// draining the list from the top. No due dates, to keep the due index out of it.
+template <typename List>
+void benchQueue(Bench& bench, const std::string& backend, const std::vector<smarttodo::NewTask>& specs,
+                std::uint64_t seed) {
+    std::ostream quiet(nullptr);
+    const std::size_t n = specs.size();
+    List list(quiet, n);
+    std::vector<smarttodo::TaskId> ids;
+    ids.reserve(n);
+    bench.run(backend + " insertTask", n, n, [&] {
+        for (const auto& s : specs) ids.push_back(list.insertTask(s.priority, s.description, ""));
+    }, &list);
+    bench.run(backend + " byPriority", n, n, [&] {
+        std::size_t walked = 0;
+        for (auto it = list.byPriority().begin(); it != list.byPriority().end(); ++it) ++walked;
+        if (walked != n) std::cerr << "byPriority short" << std::endl;
+    });
+    std::mt19937_64 rng(seed);
+    std::shuffle(ids.begin(), ids.end(), rng);
+    bench.run(backend + " updatePriority", n, n, [&] {
+        for (std::size_t i = 0; i < n; ++i) list.updatePriority(ids[i], 1 + static_cast<int>(i % 5));
+    });
+    bench.run(backend + " removeTask", n, n, [&] {
+        for (std::size_t i = 0; i < n; ++i) list.removeTask();
+    });
+}
+
+void benchSize(Bench& bench, std::size_t n, const Options& opts) {
+    std::ostream quiet(nullptr); // badbit stream: ToDoList output is discarded unformatted
+    const std::vector<smarttodo::NewTask> specs = generateTasks(n, opts.seed);
+    const std::string txtPath = (opts.dir / "smarttodo_bench_tasks.txt").string();
+    const std::string csvPath = (opts.dir / "smarttodo_bench_tasks.csv").string();
+    const std::string snapPath = (opts.dir / "smarttodo_bench_tasks.db").string();
+
+    smarttodo::ToDoList list(quiet, n);
+    std::vector<smarttodo::TaskId> ids;
+    ids.reserve(n);
+    bench.run("insertTask", n, n, [&] {
+        for (const auto& s : specs) ids.push_back(list.insertTask(s.priority, s.description, s.dueDate));
+    }, &list);
+    bench.run("displayTasks", n, n, [&] { list.displayTasks(); });
+    bench.run("displayTasks page 1", n, 1, [&] { list.displayTasks(0, 20); });
+    bench.run("topK(100)", n, 1, [&] {
+        if (list.topK(100).size() != std::min<std::size_t>(n, 100)) std::cerr << "topK short" << std::endl;
+    });
+    bench.run("remindUrgentTasks", n, n, [&] { list.remindUrgentTasks(); });
+    {
+        smarttodo::ReminderScheduler reminders([](const smarttodo::Reminder&) {});
+        bench.run("attachReminders", n, n, [&] { list.attachReminders(&reminders); });
+        list.attachReminders(nullptr);
+    }
+    const std::size_t queries = 100;
+    bench.run("search", n, queries, [&] {
+        for (std::size_t q = 0; q < queries; ++q) {
+            std::size_t i = q * n / queries;
+            list.search("ref " + std::to_string(100000 + i % 900000) + " " +
+                        specs[i].description.substr(0, 3));
+        }
+    });
+    bench.run("search (linear scan)", n, queries / 10, [&] {
+        for (std::size_t q = 0; q < queries / 10; ++q) {
+            std::string term = "ref " + std::to_string(100000 + q * n / queries % 900000);
+            std::size_t hits = 0;
+            for (smarttodo::TaskId id : ids) hits += smarttodo::SearchIndex::matches(list.get(id)->description, term);
+            if (!hits) std::cerr << "scan found nothing" << std::endl;
+        }
+    });
+    const std::time_t now = std::time(nullptr);
+    smarttodo::TaskQuery dueSoon; // a dashboard panel: urgent tasks due this week
+    dueSoon.maxPriority = 2;
+    dueSoon.dueMin = now;
+    dueSoon.dueMax = now + 7 * 24 * 3600;
+    smarttodo::TaskQuery overdue;
+    overdue.dueMax = now - 1;
+    bench.run("query p<=2 due 7d top 20", n, queries, [&] {
+        for (std::size_t q = 0; q < queries; ++q) list.query(dueSoon, 20);
+    });
+    bench.run("query p<=2 due 7d", n, queries / 10, [&] {
+        for (std::size_t q = 0; q < queries / 10; ++q) list.query(dueSoon);
+    });
+    bench.run("query overdue top 20", n, queries, [&] {
+        for (std::size_t q = 0; q < queries; ++q) list.query(overdue, 20);
+    });
+    bench.run("query p<=2 due 7d (linear scan)", n, queries / 10, [&] {
+        for (std::size_t q = 0; q < queries / 10; ++q) {
+            std::size_t hits = 0;
+            for (smarttodo::TaskId id : ids) {
+                auto task = list.get(id);
+                hits += task->priority <= dueSoon.maxPriority && task->dueTime >= dueSoon.dueMin &&
+                        task->dueTime <= dueSoon.dueMax;
+            }
+            if (!hits && n >= 1000) std::cerr << "scan found nothing" << std::endl;
+        }
+    });
+    bench.run("saveToFile", n, n, [&] { list.saveToFile(txtPath); });
+    bench.run("exportToCSV", n, n, [&] { list.exportToCSV(csvPath); });
+    {
+        smarttodo::ToDoList imported(quiet, n);
+        bench.run("importFromCSV", n, n, [&] { imported.importFromCSV(csvPath); }, &imported);
+        smarttodo::ToDoList full(quiet, 0); // every row parsed, none stored
+        bench.run("importFromCSV parse only", n, n, [&] { full.importFromCSV(csvPath); });
+    }
+    bench.run("exportTasks csv 1 thread", n, n, [&] {
+        list.exportTasks(csvPath, smarttodo::ExportFormat::Csv, 1);
+    });
+    bench.run("exportTasks ndjson", n, n, [&] {
+        list.exportTasks(csvPath, smarttodo::ExportFormat::Ndjson);
+    });
+    bench.run("exportTasks columnar", n, n, [&] {
+        list.exportTasks(csvPath, smarttodo::ExportFormat::Columnar);
+    });
+    bench.run("saveSnapshot", n, n, [&] { list.saveSnapshot(snapPath); });
+
+    std::mt19937_64 rng(opts.seed);
+    std::shuffle(ids.begin(), ids.end(), rng);
+    smarttodo::ToDoList byId(quiet, n);
+    byId.loadSnapshot(snapPath);
+    bench.run("get(id)", n, n, [&] {
+        std::size_t found = 0;
+        for (auto id : ids) found += byId.get(id).has_value();
+        if (found != n) std::cerr << "get(id) missed tasks" << std::endl;
+    });
+    bench.run("updatePriority", n, n, [&] {
+        for (std::size_t i = 0; i < n; ++i) byId.updatePriority(ids[i], 1 + static_cast<int>(i % 5));
+    });
+    bench.run("remove(id)", n, n, [&] {
+        for (auto id : ids) byId.remove(id);
+    });
+
+    smarttodo::ToDoList loaded(quiet, n);
+    bench.run("loadFromFile", n, n, [&] { loaded.loadFromFile(txtPath); }, &loaded);
+    bench.run("removeTask", n, n, [&] {
+        for (std::size_t i = 0; i < n; ++i) loaded.removeTask();
+    });
+    bench.run("loadSnapshot", n, n, [&] { loaded.loadSnapshot(snapPath); }, &loaded);
+    bench.run("completeTopK", n, n, [&] { loaded.completeTopK(n); });
+
+    // each task waits for up to five of the thousand added before it
+    {
+        std::vector<smarttodo::TaskId> byAge(ids);
+        std::sort(byAge.begin(), byAge.end());
+        std::vector<smarttodo::Dependency> edges;
+        edges.reserve(5 * n);
+        for (std::size_t i = 1; i < n; ++i) {
+            for (int k = 0; k < 5; ++k) edges.push_back({byAge[i], byAge[i - 1 - rng() % std::min<std::size_t>(i, 1000)]});
+        }
+        smarttodo::ToDoList dag(quiet, n);
+        dag.loadSnapshot(snapPath);
+        bench.run("addDependencies 5 per task", n, edges.size(), [&] { dag.addDependencies(edges); });
+        bench.run("saveSnapshot (with edges)", n, n, [&] { dag.saveSnapshot(snapPath); });
+        bench.run("loadSnapshot (with edges)", n, n, [&] { dag.loadSnapshot(snapPath); }, &dag);
+        bench.run("removeTask (with edges)", n, n, [&] {
+            for (std::size_t i = 0; i < n; ++i) dag.removeTask();
+        });
+    }
+
+    smarttodo::ToDoList bulk(quiet, n);
+    bench.run("insertTasks", n, n, [&] { bulk.insertTasks(specs); }, &bulk);
+    benchQueue<smarttodo::ToDoList>(bench, "heap", specs, opts.seed);
+    benchQueue<smarttodo::BucketToDoList>(bench, "buckets", specs, opts.seed);
+#if SMARTTODO_METRICS
+    // what the instrumentation adds to each timed operation
+    bench.run("metrics ScopedTimer", n, n, [&] {
+        for (std::size_t i = 0; i < n; ++i) smarttodo::metrics::ScopedTimer timer(smarttodo::metrics::Op::Insert);
+    });
+#endif
+
+    {
+        // the same inserts as a script, as `smarttodo_app --batch` would run them
+        std::string script;
+        for (const auto& s : specs) {
+            script += "add " + std::to_string(s.priority) + " " + s.description + " | " + s.dueDate + "\n";
+        }
+        for (std::size_t i = 0; i < n; ++i) script += "remove\n";
+        smarttodo::ToDoList batched(quiet, n);
+        std::istringstream in(script);
+        bench.run("runBatch add+remove", n, 2 * n, [&] { smarttodo::runBatch(batched, in, quiet); });
+    }
+
+    const std::string walPath = (opts.dir / "smarttodo_bench_tasks.wal").string();
+    std::remove(snapPath.c_str());
+    std::remove(walPath.c_str());
+    {
+        smarttodo::ToDoList journaled(quiet, n);
+        journaled.openJournal(snapPath, walPath);
+        bench.run("insertTask+journal", n, n, [&] {
+            for (const auto& s : specs) journaled.insertTask(s.priority, s.description, s.dueDate);
+        });
+        bench.run("checkpoint", n, 1, [&] { journaled.checkpoint(); });
+        // only the freeze: encoding and writing continue on the compaction thread
+        bench.run("checkpointInBackground", n, 1, [&] { journaled.checkpointInBackground(); });
+        bench.run("removeTask during save", n, n / 2, [&] {
+            for (std::size_t i = 0; i < n / 2; ++i) journaled.removeTask();
+        });
+    }
+    std::remove(walPath.c_str());
+    std::remove((walPath + ".old").c_str());
+
+    std::remove(txtPath.c_str());
+    std::remove(csvPath.c_str());
+    std::remove(snapPath.c_str());
+}
+
+// Every thread alternates an insert and a pop on a list prefilled with `prefill` tasks;
+// the total work is fixed, so ns/op falling with more threads is the scaling.
+template <typename Insert, typename Pop>
+void runContention(Bench& bench, const std::string& op, std::size_t threads, std::size_t prefill,
+                   Insert insert, Pop pop) {
+    const std::size_t totalPairs = 400000;
+    const std::size_t perThread = totalPairs / threads;
+    for (std::size_t i = 0; i < prefill; ++i) insert(static_cast<int>(i % 5), i);
+    bench.run(op, prefill, 2 * perThread * threads, [&] {
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (std::size_t i = 0; i < perThread; ++i) {
+                    insert(static_cast<int>((i + t) % 5), i);
+                    pop();
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+    });
+}
+
+void benchContention(Bench& bench, const Options& opts) {
+    const std::size_t prefill = 10000;
+    const std::string desc = "contended task";
+    for (std::size_t threads = 1; threads <= opts.maxThreads; threads *= 2) {
+        const std::string suffix = " x" + std::to_string(threads);
+        {
+            std::ostream quiet(nullptr);
+            smarttodo::ToDoList list(quiet, smarttodo::ToDoList::kAllTasks);
+            std::mutex mutex;
+            runContention(bench, "mutex list" + suffix, threads, prefill,
+                          [&](int priority, std::size_t) {
+                              std::lock_guard<std::mutex> lock(mutex);
+                              list.insertTask(priority, desc, "");
+                          },
+                          [&] {
+                              std::lock_guard<std::mutex> lock(mutex);
+                              list.removeTask();
+                          });
+        }
+        {
+            smarttodo::ConcurrentToDoList list;
+            runContention(bench, "multiqueue" + suffix, threads, prefill,
+                          [&](int priority, std::size_t) { list.insertTask(priority, desc, ""); },
+                          [&] { list.popMin(); });
+        }
+        if (threads > opts.maxThreads / 2) break;
+    }
+}
+
+// Round trips through a TaskServer on a Unix socket, one request at a time and then
+// pipelined, from a client in this process.
+void benchServer(Bench& bench, const Options& opts) {
+    const std::size_t ops = 20000;
+    const std::string path = (opts.dir / "smarttodo_bench.sock").string();
+    smarttodo::TaskServer server(2 * ops);
+    if (!server.listen(path)) {
+        std::cerr << "cannot listen on " << path << std::endl;
+        return;
+    }
+    std::thread loop([&] { server.serve(); });
+    smarttodo::TaskClient client;
+    if (client.connect(path)) {
+        bench.run("server add (round trip)", ops, ops, [&] {
+            for (std::size_t i = 0; i < ops; ++i) client.call("add 3 served task " + std::to_string(i));
+        });
+        bench.run("server peek (round trip)", ops, ops, [&] {
+            for (std::size_t i = 0; i < ops; ++i) client.call("peek");
+        });
+        bench.run("server add (pipelined)", ops, ops, [&] {
+            for (std::size_t i = 0; i < ops; ++i) {
+                client.send("add 3 served task " + std::to_string(i));
+                if (client.inFlight() >= 256) client.receive();
+            }
+            while (client.inFlight()) client.receive();
+        });
+    }
+    server.stop();
+    loop.join();
+}
+
+// Many small named lists, far more than stay resident: opening them round robin loads
+// and evicts on every call; the cross-list query reads one summary per list.
+void benchLists(Bench& bench, const Options& opts) {
+    const std::size_t listCount = 1000;
+    const std::size_t perList = 100;
+    const std::filesystem::path dir = opts.dir / "smarttodo_bench_lists";
+    std::filesystem::remove_all(dir);
+    std::ostream quiet(nullptr);
+    smarttodo::ListManagerOptions options;
+    options.maxOpenLists = 16;
+    options.out = &quiet;
+    {
+        smarttodo::ListManager lists(dir.string(), options);
+        bench.run("ListManager create+evict", listCount, listCount, [&] {
+            for (std::size_t l = 0; l < listCount; ++l) {
+                auto list = lists.open("list" + std::to_string(l));
+                for (std::size_t i = 0; i < perList; ++i) list->insertTask(1 + static_cast<int>((l + i) % 5), "task", "");
+            }
+        });
+        bench.run("ListManager open (evicting)", listCount, listCount, [&] {
+            for (std::size_t l = 0; l < listCount; ++l) lists.open("list" + std::to_string((l * 7) % listCount));
+        });
+        bench.run("ListManager topUrgent(10)", listCount, 1, [&] { lists.topUrgent(10); });
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// The out-of-core list on its own, so the peak RSS column shows its budget rather than
+// what the in-memory rows reached. Tasks are generated as they are inserted, since a
+// list this size is not meant to fit in memory.
+void benchExternal(Bench& bench, std::size_t n, const Options& opts) {
+    std::ostream quiet(nullptr);
+    const std::filesystem::path dir = opts.dir / "smarttodo_bench_external";
+    const std::string csvPath = (opts.dir / "smarttodo_bench_external.csv").string();
+    std::filesystem::remove_all(dir);
+    smarttodo::ExternalListOptions options;
+    options.memoryBudget = opts.externalBudgetMb * 1024 * 1024;
+    options.out = &quiet;
+    {
+        smarttodo::ExternalToDoList list(dir.string(), options);
+        std::mt19937_64 rng(opts.seed);
+        std::string desc;
+        bench.run("external insertTask", n, n, [&] {
+            for (std::size_t i = 0; i < n; ++i) {
+                desc = "archived task ref " + std::to_string(i);
+                desc.append(8 + rng() % 48, 'x');
+                list.insertTask(1 + static_cast<int>(rng() % 5), desc, "");
+            }
+        }, &list);
+        bench.run("external flush", n, 1, [&] { list.flush(); });
+        bench.run("external displayTasks", n, n, [&] { list.displayTasks(); });
+        bench.run("external exportToCSV", n, n, [&] { list.exportToCSV(csvPath); });
+        bench.run("external removeTask", n, n, [&] {
+            for (std::size_t i = 0; i < n; ++i) list.removeTask();
+        }, &list);
+    }
+    std::filesystem::remove_all(dir);
+    std::remove(csvPath.c_str());
+}
+
+bool parseArgs(int argc, char** argv, Options& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--min") opts.minTasks = std::strtoull(value, nullptr, 10);
+        else if (arg == "--max") opts.maxTasks = std::strtoull(value, nullptr, 10);
+        else if (arg == "--seed") opts.seed = std::strtoull(value, nullptr, 10);
+        else if (arg == "--json") opts.jsonPath = value;
+        else if (arg == "--dir") opts.dir = value;
+        else if (arg == "--threads") opts.maxThreads = std::strtoull(value, nullptr, 10);
+        else if (arg == "--external") opts.externalBudgetMb = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return opts.minTasks > 0 && opts.minTasks <= opts.maxTasks && opts.maxThreads > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "Usage: smarttodo_bench [--min N] [--max N] [--seed S] [--json FILE] "
+                     "[--dir DIR] [--threads N] [--external BUDGET_MB]\n";
+        return 2;
+    }
+
+    Bench bench;
+    bench.printHeader();
+    for (std::size_t n = opts.minTasks; n <= opts.maxTasks; n *= 10) {
+        if (opts.externalBudgetMb) benchExternal(bench, n, opts);
+        else benchSize(bench, n, opts);
+        if (n > opts.maxTasks / 10) break;
+    }
+
+    if (!opts.externalBudgetMb) {
+        benchContention(bench, opts);
+        benchServer(bench, opts);
+        benchLists(bench, opts);
+    }
+
+    if (!opts.jsonPath.empty() && !bench.writeJson(opts.jsonPath, opts)) {
+        std::cerr << "Failed to write " << opts.jsonPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "list_manager.h"
+#include "todo.h"
+
+namespace smarttodo {
+
+// Script commands, one per line; blank lines and lines starting with '#' are skipped:
+//   add <priority> <description> [| <due date>]   remove            peek
+//   repeat <every> <priority> <description> [| <first due date>]
+//   delete <id>         update <id> <priority>    view [offset [limit]]
+//   depend <id> <prerequisite id>
+//   search <query>      export <file>             import <file>     remind
+//   save                stats (operation counts and latencies, see metrics.h)
+// `repeat` adds a recurring task, <every> spelled as parseRecurrence() reads it ("1d",
+// "2w", "1m"); `remove` completing an occurrence queues the next one.
+// `depend` keeps task <id> out of the queue until <prerequisite id> is done (see
+// ToDoList::addDependency).
+// `import` adds the rows of a CSV file and prints "<file>:<line>: <reason>" for each
+// row it skipped (see ToDoList::importFromCSV).
+// `save` starts a background checkpoint and returns at once (see
+// ToDoList::checkpointInBackground).
+// Results print as the interactive menu prints them; the list's own messages go to the
+// stream it was constructed with, so give it the same stream to keep them in order.
+//
+// Runs one command; blank and comment lines do nothing. On a malformed or unknown
+// command, or one that names no existing task, returns false and sets `error`.
+// `List` is ToDoList or BucketToDoList.
+template <typename List>
+bool runBatchCommand(List& list, std::string_view line, std::ostream& out, std::string& error);
+
+struct BatchStats {
+    std::size_t commands = 0;
+    std::size_t failed = 0;
+    std::chrono::nanoseconds elapsed{0};
+};
+
+// Runs every command in `in`; a failing command prints "Line N: <error>" and the run
+// goes on.
+template <typename List>
+BatchStats runBatch(List& list, std::istream& in, std::ostream& out);
+// The same over many lists. Two more commands: "use <name>" makes a list current
+// (created if new) for the commands that follow, and "top [k]" prints the k (default
+// 10) most urgent tasks across all lists.
+BatchStats runBatch(ListManager& lists, std::istream& in, std::ostream& out);
+
+// Collects output in one large block and hands it to `sink` only when the block fills
+// or on drain()/destruction. Flush requests (std::endl) are ignored, so a batch run that
+// prints a line per command makes a write() per block rather than per line.
+class BatchOutputBuffer : public std::streambuf {
+public:
+    explicit BatchOutputBuffer(std::streambuf* sink, std::size_t size = 1 << 16);
+    ~BatchOutputBuffer() override;
+    BatchOutputBuffer(const BatchOutputBuffer&) = delete;
+    BatchOutputBuffer& operator=(const BatchOutputBuffer&) = delete;
+
+    // Passes everything buffered on and flushes the sink.
+    void drain();
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override { return 0; }
+
+private:
+    bool writeBuffered();
+
+    std::streambuf* sink_;
+    std::vector<char> buffer_;
+};
+
+} // namespace smarttodo
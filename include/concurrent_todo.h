@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "todo.h"
+
+namespace smarttodo {
+
+// A priority queue of tasks for many producer and consumer threads, built as a
+// MultiQueue: tasks are spread over several independently locked heaps ("shards"), an
+// insert goes to a random shard, and popMin() compares the cached minima of two random
+// shards and pops from the better one. Threads rarely meet on the same lock, so
+// throughput grows with the thread count where a single mutex-guarded ToDoList would
+// serialize them.
+//
+// Ordering guarantees:
+// - Relaxed, not strict: popMin() returns a task close to the most urgent one, but not
+//   necessarily it. Its expected rank among the queued tasks is O(shards), independent
+//   of the queue length. With one shard the order is exact.
+// - Among equal priorities within a shard, tasks come out in insertion order; across
+//   shards there is no FIFO guarantee.
+// - No task is lost or returned twice. popMin() returns nullopt only if it found every
+//   shard empty during one sweep; tasks inserted concurrently with that sweep may be
+//   missed.
+// - peekMin() and size() are snapshots that may be stale by the time they return.
+//
+// Unlike ToDoList this class prints nothing and keeps no journal or indexes.
+class ConcurrentToDoList {
+public:
+    static constexpr std::size_t kUnbounded = std::numeric_limits<std::size_t>::max();
+
+    // shards == 0 picks twice the hardware thread count.
+    explicit ConcurrentToDoList(std::size_t shards = 0, std::size_t maxTasks = kUnbounded);
+    ~ConcurrentToDoList();
+    ConcurrentToDoList(const ConcurrentToDoList&) = delete;
+    ConcurrentToDoList& operator=(const ConcurrentToDoList&) = delete;
+
+    // Returns the new task's ID, or kNoTaskId if the list is full.
+    TaskId insertTask(int priority, const std::string& desc, const std::string& dueDate);
+    std::optional<Task> popMin();
+    std::optional<Task> peekMin() const;
+
+    std::size_t size() const;
+    std::size_t shardCount() const { return shardCount_; }
+
+private:
+    struct Shard;
+
+    TaskId nextId();
+    Shard& pickShard() const;
+    static std::optional<Task> popFrom(Shard& shard);
+
+    const std::size_t shardCount_;
+    std::unique_ptr<Shard[]> shards_;
+    const std::size_t maxTasks_;
+    const std::uint64_t instance_; // tells this list's per-thread ID blocks from others'
+    std::atomic<TaskId> nextIdBlock_{1};
+    std::atomic<std::size_t> reserved_{0}; // only maintained when maxTasks_ is bounded
+};
+
+} // namespace smarttodo
@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace smarttodo {
+
+// A vector stored in fixed pages of kPageSize elements that can be shared copy-on-write.
+// share() hands out a read-only copy in O(size / kPageSize) by taking a reference to
+// every page. After that, the first write to each page clones it if the copy still holds
+// it. A page is cloned at most once per share(), and never when the copy is already gone.
+//
+// The copy can be read on another thread while this vector keeps being modified. Its
+// pages are never written again, and the reference counts are atomic. Element reads cost
+// one extra indirection over std::vector.
+template <typename T>
+class CowVector {
+    static constexpr std::size_t kPageBits = 10;
+    static constexpr std::size_t kPageMask = (std::size_t{1} << kPageBits) - 1;
+
+public:
+    static constexpr std::size_t kPageSize = std::size_t{1} << kPageBits;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const T& operator*() const { return (*vector_)[index_]; }
+        const_iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        friend class CowVector;
+        const_iterator(const CowVector* vector, std::size_t index) : vector_(vector), index_(index) {}
+        const CowVector* vector_;
+        std::size_t index_;
+    };
+
+    CowVector() = default;
+    CowVector(CowVector&&) noexcept = default;
+    CowVector& operator=(CowVector&&) noexcept = default;
+    // Copies only through share(), so pages are never shared by accident.
+    CowVector(const CowVector&) = delete;
+    CowVector& operator=(const CowVector&) = delete;
+
+    // A read-only copy of the current contents. Later writes to this vector do not
+    // show through it.
+    CowVector share() const {
+        ++epoch_; // every page now counts as possibly shared
+        CowVector copy;
+        copy.pages_ = pages_;
+        copy.owned_.assign(pages_.size(), 0);
+        copy.size_ = size_;
+        return copy;
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::size_t capacity() const { return pages_.size() * kPageSize; }
+    const T& operator[](std::size_t i) const { return pages_[i >> kPageBits]->items[i & kPageMask]; }
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[size_ - 1]; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size_); }
+
+    // The element for writing, cloning its page first if a copy may still read it.
+    T& modify(std::size_t i) {
+        const std::size_t page = i >> kPageBits;
+        if (owned_[page] != epoch_) own(page);
+        return pages_[page]->items[i & kPageMask];
+    }
+    void set(std::size_t i, const T& value) { modify(i) = value; }
+
+    void push_back(const T& value) {
+        if (size_ == capacity()) {
+            pages_.push_back(std::make_shared<Page>());
+            owned_.push_back(epoch_);
+        }
+        modify(size_++) = value;
+    }
+    void pop_back() { --size_; }
+    void clear() {
+        pages_.clear();
+        owned_.clear();
+        size_ = 0;
+    }
+    void reserve(std::size_t n) {
+        pages_.reserve((n + kPageMask) >> kPageBits);
+        owned_.reserve((n + kPageMask) >> kPageBits);
+    }
+
+private:
+    struct Page {
+        T items[kPageSize];
+    };
+
+    void own(std::size_t page) {
+        if (pages_[page].use_count() == 1) {
+            // the last copy let go; its reads happen before we write
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } else {
+            pages_[page] = std::make_shared<Page>(*pages_[page]);
+        }
+        owned_[page] = epoch_;
+    }
+
+    std::vector<std::shared_ptr<Page>> pages_;
+    // The epoch at which each page was last known to be ours alone.
+    std::vector<std::uint32_t> owned_;
+    mutable std::uint32_t epoch_ = 1; // bumped by share(), which is otherwise read-only
+    std::size_t size_ = 0;
+};
+
+} // namespace smarttodo
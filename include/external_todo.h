@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "todo.h"
+
+namespace smarttodo {
+
+struct ExternalListOptions {
+    // Bytes for the insert buffer and the run read buffers together. Half goes to the
+    // buffer, the rest to one read buffer per run plus as many for a streaming pass.
+    std::size_t memoryBudget = 64 * 1024 * 1024;
+    // Runs kept before the smaller half of them is merged into one.
+    std::size_t maxRuns = 64;
+    std::ostream* out = &std::cout; // where the list prints its messages
+};
+
+// A task list for archives larger than memory. Tasks live in one directory as runs:
+// files of tasks sorted by priority, then ID. New tasks collect in an in-memory buffer,
+// which is sorted and written out as a new run once it fills its half of the budget.
+// Every run has a read cursor at its first task not yet removed, and a heap over those
+// cursors and the buffer serves peekTask() and removeTask() in O(log runs), reading
+// each run once from front to back. displayTasks(), saveToFile() and exportToCSV()
+// stream a k-way merge of the runs and the buffer through cursors of their own.
+//
+// Memory stays near memoryBudget however many tasks the list holds; disk use is the
+// size of the tasks not yet removed plus what the runs' consumed fronts still hold
+// until a run is used up or merged. Once there are more than maxRuns runs, the smaller
+// half is merged into one, so every task is rewritten O(log(tasks / buffer)) times.
+//
+// Ties come out in insertion order; IDs are per directory. flush() (and destruction)
+// writes the buffer out and records the runs and cursors in a manifest, which open()
+// reads back, so a directory holds a list across runs of the program. Only the queue
+// operations are offered: tasks are not found by ID, searched or reprioritized, and a
+// recurring task's rule is dropped on load. Not thread-safe.
+class ExternalToDoList {
+public:
+    explicit ExternalToDoList(std::string directory, ExternalListOptions options = ExternalListOptions());
+    // Flushes.
+    ~ExternalToDoList();
+    ExternalToDoList(const ExternalToDoList&) = delete;
+    ExternalToDoList& operator=(const ExternalToDoList&) = delete;
+
+    // Picks up the list a previous flush() left in the directory, deleting run files the
+    // manifest does not name (left by a crash). A list already holding tasks is flushed
+    // first. True if there was none; false, leaving the list empty, if it cannot be read
+    // (or as it was, if the flush fails).
+    bool open();
+    // Writes the buffer out as a run and the manifest after it, both synced.
+    bool flush();
+
+    // Returns the new task's ID, or kNoTaskId if a full buffer could not be written out.
+    TaskId insertTask(int priority, const std::string& desc, const std::string& dueDate);
+    void removeTask();
+    void peekTask() const;
+    // As ToDoList::displayTasks(), streamed: costs reading offset + limit tasks, and the
+    // output is written out as it grows.
+    void displayTasks(std::size_t offset = 0, std::size_t limit = ToDoList::kAllTasks) const;
+    // The text format, in priority order. Writes to a temporary file and renames it.
+    bool saveToFile(const std::string& filename) const;
+    // Replaces the list with the tasks of a text file, read line by line. Lines left
+    // unloaded when a run cannot be written count as rejected.
+    LoadStats loadFromFile(const std::string& filename);
+    // The CSV layout of ToDoList::exportToCSV(), in priority order.
+    void exportToCSV(const std::string& filename) const;
+
+    std::size_t size() const { return size_; }
+    std::size_t runCount() const { return runs_.size(); }
+    // Bytes held in memory: the buffer and the runs' cursors.
+    std::size_t memoryUsage() const;
+
+private:
+    class Cursor; // reads a run in order; see src/external_todo.cpp
+    struct Run {
+        std::uint64_t number; // the file is "run-<number>.dat"
+        std::uint64_t remaining;
+        std::unique_ptr<Cursor> cursor;
+    };
+    // A buffered task; its description is `length` bytes at `offset` in buffer_.
+    struct Pending {
+        int priority;
+        std::uint32_t length;
+        std::time_t created;
+        std::time_t dueTime;
+        TaskId id;
+        std::size_t offset;
+    };
+
+    std::string runPath(std::uint64_t number) const;
+    std::size_t blockSize() const;
+    TaskId add(int priority, std::string_view desc, std::time_t created, std::time_t dueTime);
+    // Sorts the buffer and writes it out as a new run, merging runs if there are too many.
+    bool spill();
+    bool mergeSmallest();
+    // Empties the list, deleting its run files.
+    void clear();
+    // Empties the list in memory only, leaving its files for open() to read.
+    void forget();
+    TaskView view(const Pending& p) const;
+    // Whether the most urgent task is in the buffer rather than atop heads_.
+    bool bufferFirst() const;
+    // The most urgent task; the list must not be empty.
+    TaskView front() const;
+    void popFront();
+    void rebuildHeads();
+    bool writeManifest() const;
+    // Deletes the files of runs no longer in the list, after writing the manifest.
+    void retire(const std::vector<std::uint64_t>& numbers);
+    // Calls visit(task) for the tasks in priority order until it returns false; false if
+    // a run could not be read.
+    template <typename Visit>
+    bool forEachInOrder(Visit visit) const;
+
+    const std::string directory_;
+    const ExternalListOptions options_;
+    std::ostream* out_;
+    std::vector<Run> runs_;
+    std::vector<std::uint32_t> heads_; // indexes into runs_, a min-heap by their cursors' tasks
+    std::vector<Pending> pending_;     // a min-heap by (priority, id)
+    std::string buffer_;
+    std::size_t size_ = 0;
+    TaskId nextId_ = 1;
+    std::uint64_t nextRun_ = 1;
+};
+
+} // namespace smarttodo
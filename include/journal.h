@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace smarttodo {
+
+struct JournalOptions {
+    // Group commit: pending records are written and fsynced together at most this often,
+    // or as soon as commitBytes are pending. A crash loses at most one such batch.
+    std::chrono::milliseconds commitInterval{20};
+    std::size_t commitBytes = 256 * 1024;
+    // Log size (committed or pending) at which the list is snapshotted in the background and the log truncated.
+    std::uint64_t compactBytes = 16ull * 1024 * 1024;
+    // A log holding anything is also compacted once it is this old, so a restart never has
+    // long to replay (zero: by size only).
+    std::chrono::seconds compactInterval{300};
+};
+
+// One logged mutation of the task with ID `id`. Inserts carry the whole task so replay
+// reproduces creation times; updates carry the new priority. The description is a view:
+// into the caller's storage when appending, into the log during replay.
+struct JournalRecord {
+    // LegacyInsert is the original insert layout, which spelled the creation time and
+    // due date as text; it is still replayed but no longer written. RecurringInsert is
+    // an Insert that also carries its task's recurrence. Depend makes task `id` wait for
+    // task `prerequisite`.
+    enum class Op : std::uint8_t {
+        LegacyInsert = 1, Remove = 2, Update = 3, Insert = 4, RecurringInsert = 5, Depend = 6
+    };
+    Op op = Op::Insert;
+    std::uint64_t lsn = 0;
+    std::uint64_t id = 0;
+    int priority = 0;
+    std::time_t created = 0;
+    std::time_t dueTime = 0;
+    std::string_view description;
+    std::string_view timestamp; // LegacyInsert only: the creation time as text
+    std::uint32_t recurrence = 0; // RecurringInsert only: the rule, packed by the list
+    std::uint64_t prerequisite = 0; // Depend only
+};
+
+// Append-only write-ahead log. append() only encodes into an in-memory batch (O(1) per
+// operation); a flusher thread writes and fsyncs each batch. Compaction rotates the log
+// to "<path>.old", lets the caller write a snapshot on a background thread and deletes
+// the rotated segment once the snapshot is durable; the rotation's own flush and rename
+// happen off the caller's thread too. Records carry log sequence numbers so replay can
+// skip whatever a snapshot already covers.
+class Journal {
+public:
+    Journal(std::string path, JournalOptions options);
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Feeds every intact record of the rotated and current segments to `apply`, in
+    // order, and cuts off a torn tail left by a crash. Returns the highest LSN seen.
+    static std::uint64_t recover(const std::string& path,
+                                 const std::function<void(const JournalRecord&)>& apply);
+
+    bool open(std::uint64_t nextLsn);
+    // Assigns the record's LSN, queues it for the next commit and returns the LSN.
+    std::uint64_t append(JournalRecord& record);
+    // Commits everything appended so far and waits for the fsync.
+    bool sync();
+    bool needsCompaction() const;
+    // Cuts the log at the last appended record and runs writeSnapshot on a background
+    // thread once everything before the cut is in the rotated segment. Returns false if a
+    // compaction is already running.
+    bool compactAsync(std::function<bool()> writeSnapshot);
+    void waitForCompaction();
+    // Drops the log after the caller wrote a snapshot covering every appended record.
+    bool reset(std::uint64_t nextLsn);
+
+private:
+    bool commit();
+    void flushLoop();
+    bool finishRotation();
+
+    const std::string path_;
+    const JournalOptions options_;
+    std::FILE* file_ = nullptr;
+    std::atomic<std::uint64_t> logBytes_{0}; // appended since the last rotation, committed or not
+    std::atomic<bool> compacting_{false};
+    std::thread compactor_;
+
+    std::mutex ioMutex_; // file handle, rotation; always taken before mutex_
+    std::mutex mutex_;   // pending batch and LSN counter
+    std::condition_variable wake_;
+    std::string pending_;
+    std::string writing_;
+    std::string rotating_;        // records before the cut, until finishRotation() writes them
+    bool rotationPending_ = false; // under mutex_
+    bool rotationOk_ = true;       // under ioMutex_
+    std::chrono::steady_clock::time_point lastCompaction_ = std::chrono::steady_clock::now();
+    std::atomic<bool> compactDue_{false}; // set by the flusher once compactInterval passes
+    std::uint64_t nextLsn_ = 1;
+    bool ok_ = true;
+    bool stop_ = false;
+    std::thread flusher_;
+};
+
+} // namespace smarttodo
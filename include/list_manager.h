@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <ctime>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "todo.h"
+
+namespace smarttodo {
+
+struct ListManagerOptions {
+    // Resident lists are evicted, least recently opened first, once their combined
+    // ToDoList::memoryUsage() passes this or there are more than maxOpenLists of them.
+    std::size_t memoryBudget = 256 * 1024 * 1024;
+    std::size_t maxOpenLists = 64; // each holds a journal, with its file and flusher thread
+    std::size_t maxTasksPerList = BucketToDoList::kDefaultMaxTasks;
+    JournalOptions journal;
+    std::ostream* out = &std::cout; // where the lists print their messages
+};
+
+// A task as a cross-list query reports it.
+struct ListTask {
+    std::string list;
+    TaskId id;
+    int priority;
+    std::time_t dueTime;
+    std::string description; // cut to kSummaryDescription bytes
+};
+
+// Many named lists in one directory, each stored as "<name>.db" plus its journal
+// "<name>.wal", of which only a bounded set is in memory. open() loads a list on first
+// use. When the resident set passes the budget, the least recently opened lists are
+// checkpointed and dropped.
+//
+// Every checkpoint also writes "<name>.sum": the list's size and its kSummaryTasks most
+// urgent tasks. Cross-list queries read those summaries rather than the lists, so they
+// cost a small file per list whatever the lists hold. A summary is as fresh as the
+// list's last eviction or flush; resident lists are answered from memory.
+//
+// Not thread-safe, like ToDoList itself.
+class ListManager {
+public:
+    // Holding a handle pins the list: it is never evicted while a handle is alive.
+    using Handle = std::shared_ptr<BucketToDoList>;
+
+    static constexpr std::size_t kSummaryTasks = 16;
+    static constexpr std::size_t kSummaryDescription = 256;
+
+    explicit ListManager(std::string directory, ListManagerOptions options = ListManagerOptions());
+    // Flushes and closes every resident list.
+    ~ListManager();
+    ListManager(const ListManager&) = delete;
+    ListManager& operator=(const ListManager&) = delete;
+
+    // Names are 1-64 characters from [A-Za-z0-9_.-] and do not start with '.'.
+    static bool validName(std::string_view name);
+
+    // The named list, loaded if it is not resident and created if it does not exist.
+    // nullptr if the name is invalid or the list's files cannot be opened. May evict
+    // other lists to stay within the budget.
+    Handle open(const std::string& name);
+    // Checkpoints the list and drops it from memory; false if it is not resident or is
+    // pinned by a handle.
+    bool evict(const std::string& name);
+    // Checkpoints every resident list and rewrites its summary.
+    void flushAll();
+
+    // Every list in the directory, resident or not, in name order.
+    std::vector<std::string> names() const;
+    std::size_t residentCount() const { return resident_.size(); }
+    std::size_t residentBytes() const;
+
+    // The k most urgent tasks across all lists (by priority; ties by list name, then
+    // each list's own order). Exact for k up to kSummaryTasks; larger k is cut to that.
+    std::vector<ListTask> topUrgent(std::size_t k) const;
+    // Sizes of all lists, from the summaries (and memory, for resident lists).
+    std::size_t totalTasks() const;
+
+private:
+    struct Resident {
+        std::string name;
+        Handle list;
+    };
+    struct Summary {
+        std::size_t size = 0;
+        std::vector<ListTask> top;
+    };
+
+    std::string pathFor(const std::string& name, const char* extension) const;
+    // Evicts unpinned lists, oldest first, until the resident set fits the budget; the
+    // most recently opened list is never evicted.
+    void trim();
+    bool flush(Resident& entry);
+    Summary summarize(const std::string& name, const BucketToDoList& list) const;
+    bool writeSummary(const std::string& name, const Summary& summary) const;
+    bool readSummary(const std::string& name, Summary& summary) const;
+    // Calls visit(name, summary) for every list: resident ones from memory, the rest
+    // from their summary files.
+    template <typename Visit>
+    void forEachSummary(Visit visit) const;
+
+    const std::string directory_;
+    const ListManagerOptions options_;
+    std::list<Resident> resident_; // most recently opened first
+    std::unordered_map<std::string, std::list<Resident>::iterator> byName_;
+};
+
+} // namespace smarttodo
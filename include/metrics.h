@@ -0,0 +1,122 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// SMARTTODO_METRICS is set by the build (CMake option SMARTTODO_METRICS). When it is 0,
+// SMARTTODO_TIME expands to nothing, so the hot paths carry no instrumentation at all and
+// snapshots come back empty.
+#ifndef SMARTTODO_METRICS
+#define SMARTTODO_METRICS 0
+#endif
+
+namespace smarttodo {
+namespace metrics {
+
+constexpr bool kEnabled = SMARTTODO_METRICS != 0;
+
+// The instrumented ToDoList operations. Remove covers remove(id) as well as removeTask(),
+// and Load/Save the snapshot as well as the text file.
+enum class Op { Insert, Remove, Load, Save, Display };
+constexpr std::size_t kOpCount = 5;
+// Lower-case name used in stats output and as the Prometheus "op" label.
+const char* opName(Op op);
+
+// Log-linear latency histogram in nanoseconds, HDR style: every power of two is split
+// into kSubBuckets equal buckets, so any recorded value is known to within 1/8 of itself
+// from 1 ns up to the full 64-bit range, in a fixed 4 KiB.
+struct Histogram {
+    static constexpr unsigned kSubBits = 3;
+    static constexpr unsigned kSubBuckets = 1u << kSubBits;
+    static constexpr std::size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    static std::size_t bucketOf(std::uint64_t ns);
+    // Smallest and largest value that land in `bucket`.
+    static std::uint64_t lowerBound(std::size_t bucket);
+    static std::uint64_t upperBound(std::size_t bucket);
+
+    // Upper bound of the bucket holding the q-th quantile (0 <= q <= 1); 0 when empty.
+    std::uint64_t quantile(double q) const;
+    // Recorded values at most `ns` (counting whole buckets that end at or below it).
+    std::uint64_t countAtMost(std::uint64_t ns) const;
+
+    std::uint64_t count = 0;
+    std::uint64_t totalNs = 0;
+    std::uint64_t maxNs = 0;
+    std::array<std::uint64_t, kBuckets> buckets{};
+};
+
+// Every thread's counts added together.
+struct Snapshot {
+    std::array<Histogram, kOpCount> ops;
+    // Since the program started.
+    std::chrono::steady_clock::duration elapsed{0};
+
+    const Histogram& operator[](Op op) const { return ops[static_cast<std::size_t>(op)]; }
+};
+
+// Records one operation on the calling thread. Each thread writes only its own
+// counters, so recording takes no lock and shares no cache line with other threads.
+void record(Op op, std::uint64_t ns);
+// Aggregates all threads, including ones that have exited. Cheap next to any real
+// operation but not free: call it on demand, not per operation.
+Snapshot snapshot();
+
+// A readable table: count, rate, mean, p50, p99 and max per operation.
+void writeTable(std::ostream& out, const Snapshot& stats);
+// Prometheus text exposition format: a histogram per operation (latency in seconds).
+void writePrometheus(std::ostream& out, const Snapshot& stats);
+// Writes writePrometheus() output to `path` through a temporary file and a rename, so a
+// scraper never reads a half-written file.
+bool dumpToFile(const std::string& path);
+
+// Rewrites a metrics file every `interval` from a background thread, and once more when
+// destroyed.
+class MetricsDumper {
+public:
+    MetricsDumper(std::string path, std::chrono::seconds interval);
+    ~MetricsDumper();
+    MetricsDumper(const MetricsDumper&) = delete;
+    MetricsDumper& operator=(const MetricsDumper&) = delete;
+
+private:
+    void run();
+
+    const std::string path_;
+    const std::chrono::seconds interval_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_; // last, so it starts after everything it uses
+};
+
+#if SMARTTODO_METRICS
+// Times the enclosing scope.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Op op) : op_(op), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+        record(op_, static_cast<std::uint64_t>(ns.count()));
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Op op_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define SMARTTODO_TIME(op) ::smarttodo::metrics::ScopedTimer smarttodo_scoped_timer_(::smarttodo::metrics::Op::op)
+#else
+#define SMARTTODO_TIME(op) ((void)0)
+#endif
+
+} // namespace metrics
+} // namespace smarttodo
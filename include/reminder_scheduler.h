@@ -0,0 +1,93 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "todo.h"
+
+namespace smarttodo {
+
+enum class ReminderKind { DueSoon, Overdue };
+
+struct Reminder {
+    ReminderKind kind;
+    TaskId id;
+    std::string description;
+    std::time_t dueTime;
+};
+
+// Fires reminders on a background thread as tasks cross into "due soon" (leadTime before
+// their due time) and again once they are overdue. Pending transitions sit in a min-heap
+// keyed by when they fire; the thread sleeps until the earliest one, so it costs nothing
+// while idle however many tasks are scheduled, and schedule()/cancel() are O(log n).
+//
+// Only transitions still ahead are queued: a task already due soon when scheduled gets
+// just its overdue reminder, and one already overdue gets none (remindUrgentTasks()
+// reports the present state). Descriptions are copied, so callbacks never touch the
+// list. The callback runs on the scheduler thread without the lock held and must not
+// throw; it may call back into the scheduler.
+class ReminderScheduler {
+public:
+    using Callback = std::function<void(const Reminder&)>;
+
+    explicit ReminderScheduler(Callback callback,
+                               std::chrono::seconds leadTime = std::chrono::hours(24));
+    // Stops the thread; reminders not yet fired are dropped.
+    ~ReminderScheduler();
+    ReminderScheduler(const ReminderScheduler&) = delete;
+    ReminderScheduler& operator=(const ReminderScheduler&) = delete;
+
+    // Schedules (or reschedules) the reminders for task `id`.
+    void schedule(TaskId id, std::string_view description, std::time_t dueTime);
+    void cancel(TaskId id);
+    void clear();
+
+    // Tasks with at least one reminder still to fire.
+    std::size_t pending() const;
+    std::chrono::seconds leadTime() const { return leadTime_; }
+
+private:
+    struct Event {
+        std::time_t at;
+        TaskId id;
+        std::uint32_t generation;
+        ReminderKind kind;
+    };
+    struct Entry {
+        std::string description;
+        std::time_t dueTime;
+        std::uint32_t generation;
+        std::uint32_t events; // still in the heap
+    };
+
+    static bool later(const Event& a, const Event& b) { return a.at > b.at; }
+    void push(const Event& event);
+    void dropEntry(std::unordered_map<TaskId, Entry>::iterator it);
+    void compact();
+    void run();
+
+    const Callback callback_;
+    const std::chrono::seconds leadTime_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    // Cancelled entries leave their events behind; they are skipped when they come up
+    // and swept out once they outnumber the live ones.
+    std::vector<Event> events_;
+    std::unordered_map<TaskId, Entry> entries_;
+    std::size_t staleEvents_ = 0;
+    std::uint32_t nextGeneration_ = 0;
+    bool stop_ = false;
+    std::thread thread_; // last, so it starts after everything it uses
+};
+
+} // namespace smarttodo
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace smarttodo {
+
+// Trigram index over task descriptions. Every distinct lowercase 3-byte sequence of a
+// description maps to a posting list of the tasks containing it; a query term's
+// candidates are the intersection of its trigrams' lists. Matches must still be
+// verified against the text, since a task can hold all of a term's trigrams without
+// holding the term.
+//
+// Postings hold document numbers handed out in add() order, so every list is sorted
+// by construction and stored delta-encoded as varints, in blocks of 128 whose first
+// entries are kept apart so a lookup can skip to the right block. Removal is lazy: the
+// caller filters out tasks that no longer exist and rebuilds the index once dead
+// entries outnumber live ones (needsRebuild()).
+class SearchIndex {
+public:
+    void add(std::uint64_t id, std::string_view description);
+    void noteRemoved() { ++dead_; }
+    bool needsRebuild() const;
+    void clear();
+
+    // Splits a query into lowercase whitespace-separated terms.
+    static std::vector<std::string> terms(std::string_view query);
+    // True if `text` contains `term` (already lowercase), ignoring ASCII case.
+    static bool matches(std::string_view text, std::string_view term);
+
+    // IDs that may contain every term, in the order they were added; nullopt when no
+    // term is long enough to narrow the search and every task is a candidate.
+    std::optional<std::vector<std::uint64_t>> candidates(const std::vector<std::string>& terms) const;
+
+    std::size_t memoryUsage() const;
+
+private:
+    struct PostingList {
+        std::vector<std::uint32_t> heads;   // first document of each block
+        std::vector<std::uint32_t> offsets; // where each block's deltas start in bytes
+        std::vector<std::uint8_t> bytes;
+        std::uint32_t last = 0;
+        std::uint32_t count = 0;
+
+        void append(std::uint32_t doc);
+        std::vector<std::uint32_t> decode() const;
+    };
+    class Cursor;
+
+    std::unordered_map<std::uint32_t, PostingList> postings_;
+    std::vector<std::uint64_t> ids_; // document number -> task ID
+    std::size_t dead_ = 0;
+};
+
+} // namespace smarttodo
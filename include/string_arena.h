@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace smarttodo {
+
+// Pool allocator for task descriptions. Each string is stored as a 4-byte length
+// followed by its bytes, and callers keep a single pointer to it. Storage comes from
+// large chunks that never move, carved into size classes with a freelist per class, so
+// completed tasks' space is reused without returning to malloc.
+//
+// adopt() lets strings live in memory the arena does not own (a mapped snapshot, whose
+// blob uses the same length-prefixed layout): those are read in place and release() on
+// them is a no-op.
+class StringArena {
+public:
+    StringArena() = default;
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+    StringArena(StringArena&&) noexcept = default;
+    StringArena& operator=(StringArena&&) noexcept = default;
+
+    const char* store(std::string_view s);
+    void release(const char* p);
+    // Keeps `region` alive for as long as strings inside it may be referenced.
+    void adopt(std::shared_ptr<const void> region);
+    void clear();
+
+    static std::string_view view(const char* p) {
+        std::uint32_t len;
+        std::memcpy(&len, p, sizeof(len));
+        return std::string_view(p + sizeof(len), len & ~kOwnedBit);
+    }
+
+    // Bytes reserved from the system, including unused chunk tails and freelists.
+    std::size_t bytesReserved() const { return reserved_; }
+
+private:
+    // Set in the length prefix of strings the arena allocated itself.
+    static constexpr std::uint32_t kOwnedBit = 0x80000000u;
+    static constexpr std::size_t kChunkBytes = 1 << 20;
+    static constexpr std::size_t kLargeBytes = 64 * 1024; // above this: own allocation
+
+    static std::size_t sizeClass(std::size_t bytes);
+    static std::size_t classBytes(std::size_t cls);
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char* cursor_ = nullptr;
+    std::size_t remaining_ = 0;
+    std::vector<std::vector<char*>> freeLists_;
+    std::unordered_map<const char*, std::unique_ptr<char[]>> large_;
+    std::vector<std::shared_ptr<const void>> adopted_;
+    std::size_t reserved_ = 0;
+};
+
+} // namespace smarttodo
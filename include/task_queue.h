@@ -0,0 +1,277 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "cow_vector.h"
+
+namespace smarttodo {
+
+// Queue backends for BasicToDoList (see todo.h). A backend orders task slots by
+// priority, lower values first, and answers:
+//   size() empty() top() priority(slot)       the most urgent slot, a slot's priority
+//   push(slot, p) erase(slot) update(slot, p) keep the order as tasks come and go
+//   append(slot, p) then restore()            bulk loading: order once at the end
+//   forEach(f) share() -> Frozen              every (slot, priority) in storage order,
+//                                             live or from a copy-on-write copy
+//   Walk                                      lazy priority-order traversal
+// Storage order is what snapshots record; pushing slots back in that order rebuilds
+// the same queue.
+
+// 4-ary min-heap of 8-byte {priority, slot} nodes, for any int priority. Sifting never
+// touches a task's other columns; pos_ tracks where each slot's node sits. Ties come
+// out in no particular order. push, erase and update cost O(log n).
+class HeapQueue {
+public:
+    struct Node {
+        std::int32_t priority;
+        std::uint32_t slot;
+    };
+    static constexpr std::size_t kArity = 4;
+
+    // The heap as it was at share(); storage order is heap order.
+    class Frozen {
+    public:
+        std::size_t size() const { return nodes_.size(); }
+        template <typename Visit>
+        void forEach(Visit visit) const {
+            for (const Node& node : nodes_) visit(node.slot, static_cast<int>(node.priority));
+        }
+
+    private:
+        friend class HeapQueue;
+        explicit Frozen(CowVector<Node> nodes) : nodes_(std::move(nodes)) {}
+        CowVector<Node> nodes_;
+    };
+
+    // Best-first search of the heap whose frontier holds the children of every node
+    // yielded so far; stepping k slots costs O(k log k). Ties in heap order.
+    class Walk {
+    public:
+        Walk() = default; // already done
+        explicit Walk(const HeapQueue& queue);
+        bool done() const { return frontier_.empty(); }
+        std::uint32_t slot() const { return queue_->heap_[frontier_.front()].slot; }
+        void next();
+
+    private:
+        // min-heap of heap positions, by (priority, position)
+        bool later(std::uint32_t a, std::uint32_t b) const;
+
+        const HeapQueue* queue_ = nullptr;
+        std::vector<std::uint32_t> frontier_;
+    };
+
+    std::size_t size() const { return heap_.size(); }
+    bool empty() const { return heap_.empty(); }
+    std::uint32_t top() const { return heap_.front().slot; }
+    int priority(std::uint32_t slot) const { return heap_[pos_[slot]].priority; }
+
+    void push(std::uint32_t slot, int priority);
+    void erase(std::uint32_t slot);
+    void update(std::uint32_t slot, int priority);
+    // Appends without sifting; restore() heapifies once if the appended order is not
+    // already a heap (a snapshot's stored order is).
+    void append(std::uint32_t slot, int priority);
+    void restore();
+
+    void clear();
+    void reserve(std::size_t n);
+    std::size_t memoryUsage() const;
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (const Node& node : heap_) visit(node.slot, static_cast<int>(node.priority));
+    }
+    Frozen share() const { return Frozen(heap_.share()); }
+
+private:
+    void track(std::uint32_t slot);
+    void place(std::size_t pos, Node node);
+    void siftUp(std::size_t pos);
+    void siftDown(std::size_t pos);
+    void heapify();
+
+    CowVector<Node> heap_;
+    std::vector<std::uint32_t> pos_;
+};
+
+// Bucket queue for priorities known to lie in [MinPriority, MaxPriority]: one FIFO list
+// per priority, linked through per-slot next/prev columns, and a bit mask of the
+// non-empty buckets. push, erase, update and top are O(1), a priority-order walk costs
+// O(1) per slot, and tasks of equal priority come out in the order they were queued (an
+// update moves the task to the back of its new priority). Priorities outside the range
+// are clamped into it.
+template <int MinPriority, int MaxPriority>
+class BucketQueue {
+    static constexpr std::size_t kBuckets = static_cast<std::size_t>(MaxPriority - MinPriority) + 1;
+    static_assert(MinPriority <= MaxPriority && kBuckets <= 64, "one mask bit per bucket");
+    static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+    using Heads = std::array<std::uint32_t, kBuckets>;
+
+public:
+    static constexpr int kMinPriority = MinPriority;
+    static constexpr int kMaxPriority = MaxPriority;
+
+    static int clamp(int priority) { return std::min(std::max(priority, MinPriority), MaxPriority); }
+
+    // The buckets as they were at share(); storage order is priority order.
+    class Frozen {
+    public:
+        std::size_t size() const { return size_; }
+        template <typename Visit>
+        void forEach(Visit visit) const {
+            walkAll(next_, heads_, visit);
+        }
+
+    private:
+        friend class BucketQueue;
+        Frozen(CowVector<std::uint32_t> next, const Heads& heads, std::size_t size)
+            : next_(std::move(next)), heads_(heads), size_(size) {}
+        CowVector<std::uint32_t> next_;
+        Heads heads_;
+        std::size_t size_;
+    };
+
+    class Walk {
+    public:
+        Walk() = default; // already done
+        explicit Walk(const BucketQueue& queue) : queue_(&queue) { seek(0); }
+        bool done() const { return slot_ == kNone; }
+        std::uint32_t slot() const { return slot_; }
+        void next() {
+            slot_ = queue_->next_[slot_];
+            if (slot_ == kNone) seek(bucket_ + 1);
+        }
+
+    private:
+        void seek(std::size_t bucket) {
+            for (; bucket < kBuckets; ++bucket) {
+                if (queue_->heads_[bucket] != kNone) {
+                    bucket_ = bucket;
+                    slot_ = queue_->heads_[bucket];
+                    return;
+                }
+            }
+        }
+
+        const BucketQueue* queue_ = nullptr;
+        std::size_t bucket_ = 0;
+        std::uint32_t slot_ = kNone;
+    };
+
+    BucketQueue() { clearHeads(); }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::uint32_t top() const { return heads_[lowestBit(nonEmpty_)]; }
+    int priority(std::uint32_t slot) const { return MinPriority + bucket_[slot]; }
+
+    void push(std::uint32_t slot, int priority) { link(slot, bucketOf(priority)); }
+    void erase(std::uint32_t slot) { unlink(slot); }
+    void update(std::uint32_t slot, int priority) {
+        const std::uint8_t bucket = bucketOf(priority);
+        if (bucket == bucket_[slot]) return; // keeps its place in line
+        unlink(slot);
+        link(slot, bucket);
+    }
+    // Appending is already O(1) and keeps the given order, so there is nothing to restore.
+    void append(std::uint32_t slot, int priority) { push(slot, priority); }
+    void restore() {}
+
+    void clear() {
+        next_.clear();
+        prev_.clear();
+        bucket_.clear();
+        clearHeads();
+        nonEmpty_ = 0;
+        size_ = 0;
+    }
+    void reserve(std::size_t n) {
+        next_.reserve(n);
+        prev_.reserve(n);
+        bucket_.reserve(n);
+    }
+    std::size_t memoryUsage() const {
+        return next_.capacity() * sizeof(std::uint32_t) + prev_.capacity() * sizeof(std::uint32_t) +
+               bucket_.capacity();
+    }
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        walkAll(next_, heads_, visit);
+    }
+    Frozen share() const { return Frozen(next_.share(), heads_, size_); }
+
+private:
+    static std::uint8_t bucketOf(int priority) { return static_cast<std::uint8_t>(clamp(priority) - MinPriority); }
+
+    // `mask` must be nonzero.
+    static std::size_t lowestBit(std::uint64_t mask) {
+#if defined(__GNUC__)
+        return static_cast<std::size_t>(__builtin_ctzll(mask));
+#else
+        std::size_t bit = 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    template <typename Visit>
+    static void walkAll(const CowVector<std::uint32_t>& next, const Heads& heads, Visit& visit) {
+        for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            const int priority = MinPriority + static_cast<int>(bucket);
+            for (std::uint32_t slot = heads[bucket]; slot != kNone; slot = next[slot]) visit(slot, priority);
+        }
+    }
+
+    void clearHeads() {
+        heads_.fill(kNone);
+        tails_.fill(kNone);
+    }
+
+    // Queues `slot` at the back of `bucket`.
+    void link(std::uint32_t slot, std::uint8_t bucket) {
+        while (next_.size() <= slot) next_.push_back(kNone);
+        if (prev_.size() <= slot) {
+            prev_.resize(slot + 1, kNone);
+            bucket_.resize(slot + 1, 0);
+        }
+        const std::uint32_t tail = tails_[bucket];
+        next_.set(slot, kNone);
+        prev_[slot] = tail;
+        bucket_[slot] = bucket;
+        if (tail == kNone) heads_[bucket] = slot;
+        else next_.set(tail, slot);
+        tails_[bucket] = slot;
+        nonEmpty_ |= std::uint64_t{1} << bucket;
+        ++size_;
+    }
+
+    void unlink(std::uint32_t slot) {
+        const std::uint8_t bucket = bucket_[slot];
+        const std::uint32_t prev = prev_[slot];
+        const std::uint32_t next = next_[slot];
+        if (prev == kNone) heads_[bucket] = next;
+        else next_.set(prev, next);
+        if (next == kNone) tails_[bucket] = prev;
+        else prev_[next] = prev;
+        if (heads_[bucket] == kNone) nonEmpty_ &= ~(std::uint64_t{1} << bucket);
+        --size_;
+    }
+
+    CowVector<std::uint32_t> next_; // shared by Frozen copies, so copy-on-write
+    std::vector<std::uint32_t> prev_;
+    std::vector<std::uint8_t> bucket_;
+    Heads heads_;
+    Heads tails_;
+    std::uint64_t nonEmpty_ = 0;
+    std::size_t size_ = 0;
+};
+
+} // namespace smarttodo
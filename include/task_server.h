@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "todo.h"
+
+namespace smarttodo {
+
+// Serves one in-memory BucketToDoList to local clients over a Unix domain socket, so several
+// tools share a list without each loading it and without clobbering each other's saves.
+//
+// Protocol: a request is one batch command line (see batch.h) ending in '\n'. Each gets
+// one response, "OK <n>\n" or "ERR <n>\n" followed by n bytes: the command's output, or
+// the error message. Clients may pipeline: requests sent back to back are answered in
+// order. The server is a single-threaded epoll loop, so commands never run concurrently
+// and the list needs no locking. Linux only; elsewhere listen() fails.
+class TaskServer {
+public:
+    explicit TaskServer(std::size_t maxTasks = BucketToDoList::kDefaultMaxTasks);
+    ~TaskServer();
+    TaskServer(const TaskServer&) = delete;
+    TaskServer& operator=(const TaskServer&) = delete;
+
+    // The served list, for loading or opening a journal before serve().
+    BucketToDoList& list() { return list_; }
+
+    // Binds the socket, replacing a stale socket file left at `path`.
+    bool listen(const std::string& path);
+    // Runs the event loop until stop(); false if the loop itself failed.
+    bool serve();
+    // Makes serve() return after the current event. Safe to call from another thread or
+    // a signal handler.
+    void stop();
+
+private:
+    struct Connection {
+        std::string in;
+        std::string out;
+        std::size_t outPos = 0; // bytes of `out` already written
+        bool peerClosed = false;
+    };
+
+    void accept();
+    void onReadable(int fd, Connection& conn);
+    void process(Connection& conn);
+    // Writes what it can and updates the epoll interest; false once the connection is
+    // finished and should be closed.
+    bool flush(int fd, Connection& conn);
+    void close(int fd);
+
+    std::ostringstream output_; // what the list prints during a command
+    BucketToDoList list_;
+    std::string socketPath_;
+    int listenFd_ = -1;
+    int epollFd_ = -1;
+    int stopFd_ = -1;
+    std::unordered_map<int, Connection> connections_;
+};
+
+// Client side of the TaskServer protocol. send() only queues a request; receive() sends
+// whatever is queued and waits for the oldest unanswered response, so a caller can keep
+// many requests in flight.
+class TaskClient {
+public:
+    struct Response {
+        bool ok;
+        std::string body;
+    };
+
+    TaskClient() = default;
+    ~TaskClient();
+    TaskClient(const TaskClient&) = delete;
+    TaskClient& operator=(const TaskClient&) = delete;
+
+    bool connect(const std::string& path);
+    // `command` must not contain '\n'.
+    bool send(std::string_view command);
+    // nullopt if the connection failed or closed.
+    std::optional<Response> receive();
+    // Sends `command` and waits for its response, skipping any still owed for earlier
+    // requests.
+    std::optional<Response> call(std::string_view command);
+    std::size_t inFlight() const { return inFlight_; }
+
+private:
+    bool flush();
+
+    int fd_ = -1;
+    std::string out_;
+    std::string in_;
+    std::size_t inPos_ = 0;
+    std::size_t inFlight_ = 0;
+};
+
+} // namespace smarttodo
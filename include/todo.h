@@ -1,30 +1,417 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "cow_vector.h"
+#include "journal.h"
+#include "search_index.h"
+#include "string_arena.h"
+#include "task_queue.h"
+
 namespace smarttodo {
 
-struct Task {
+// Sentinel for a missing or unparseable time; sorts after every real time.
+constexpr std::time_t kNoTime = std::numeric_limits<std::time_t>::max();
+
+using TaskId = std::uint64_t;
+// Never assigned to a task; insertTask returns it when the list is full.
+constexpr TaskId kNoTaskId = 0;
+
+// The priorities the app's front-ends accept, 1 being the most urgent.
+constexpr int kMinPriority = 1;
+constexpr int kMaxPriority = 5;
+
+// A task read in place. Times are epoch seconds (kNoTime when unset); the description
+// points into the list's storage and stays valid until that task is removed.
+struct TaskView {
+    TaskId id;
+    int priority;
+    std::string_view description;
+    std::time_t created;
+    std::time_t dueTime;
+};
+
+// A filter for query(). Every bound is inclusive and every field starts fully open, so
+// only the bounds a query sets narrow it. A task with no due date has dueTime kNoTime:
+//   overdue:      dueMax = now - 1
+//   due soon:     dueMin = now + 1, dueMax = now + 24h
+//   no due date:  dueMin = kNoTime
+struct TaskQuery {
+    int minPriority = std::numeric_limits<int>::min();
+    int maxPriority = std::numeric_limits<int>::max();
+    std::time_t dueMin = std::numeric_limits<std::time_t>::min();
+    std::time_t dueMax = kNoTime;
+    std::time_t createdMin = std::numeric_limits<std::time_t>::min();
+    std::time_t createdMax = kNoTime;
+};
+
+// How a recurring task repeats: every `every` days, weeks or calendar months (local
+// time; a month step keeps the day of the month, clamped to the month's length).
+struct Recurrence {
+    enum class Unit : std::uint8_t { Day, Week, Month };
+    Unit unit = Unit::Day;
+    std::uint16_t every = 1;
+};
+
+constexpr std::uint16_t kMaxRecurrenceCount = 9999;
+
+// Recurrences are spelled <count><d|w|m>, e.g. "1d", "2w", "3m" (count 1 to
+// kMaxRecurrenceCount). parseRecurrence returns nullopt for anything else.
+std::optional<Recurrence> parseRecurrence(std::string_view text);
+std::string formatRecurrence(Recurrence r);
+
+// A task to add through insertTasks(); the due date may be empty.
+struct NewTask {
     int priority;
     std::string description;
-    std::string timestamp;
     std::string dueDate;
 };
 
-class ToDoList {
+// An edge for addDependencies(): `task` waits until `prerequisite` is done.
+struct Dependency {
+    TaskId task;
+    TaskId prerequisite;
+};
+
+// A task by value, as handed back by completeTopK().
+struct Task {
+    TaskId id;
+    int priority;
+    std::string description;
+    std::time_t created;
+    std::time_t dueTime;
+};
+
+class ReminderScheduler;
+
+// File formats exportTasks() writes.
+enum class ExportFormat { Csv, Ndjson, Columnar };
+
+// Outcome of a text import: lines turned into tasks and malformed lines skipped.
+struct LoadStats {
+    std::size_t loaded = 0;
+    std::size_t rejected = 0;
+};
+
+// A row importFromCSV() skipped: the line it starts on (0 for the file as a whole) and why.
+struct ImportError {
+    std::size_t line;
+    std::string reason;
+};
+
+// Outcome of a CSV import: rows added, rows skipped, and why the first kMaxErrors of
+// those were skipped.
+struct ImportStats {
+    static constexpr std::size_t kMaxErrors = 100;
+    std::size_t imported = 0;
+    std::size_t rejected = 0;
+    std::vector<ImportError> errors;
+};
+
+// A task list over a queue backend from task_queue.h, which decides the priority order
+// and its costs; the aliases below name the two in use. Member definitions live in
+// src/ and are instantiated there for those two backends only.
+template <typename Queue>
+class BasicToDoList {
 public:
-    ToDoList() = default;
-    void insertTask(int priority, const std::string& desc, const std::string& dueDate);
+    static constexpr std::size_t kDefaultMaxTasks = 1000;
+    static constexpr std::size_t kAllTasks = std::numeric_limits<std::size_t>::max();
+    class PriorityIterator;
+    class PriorityRange;
+
+    BasicToDoList() = default;
+    // Messages go to `out` instead of std::cout; pass a stream with a null rdbuf to
+    // silence them (benchmarks do this to time the list rather than the terminal).
+    explicit BasicToDoList(std::ostream& out, std::size_t maxTasks = kDefaultMaxTasks);
+    ~BasicToDoList();
+    BasicToDoList(BasicToDoList&&) noexcept;
+    BasicToDoList& operator=(BasicToDoList&&) noexcept;
+
+    // Returns the new task's ID, or kNoTaskId if the list is full. The due date is
+    // parsed once here; one that does not parse counts as no due date.
+    TaskId insertTask(int priority, const std::string& desc, const std::string& dueDate);
+    // A recurring task. Only its next occurrence is ever queued: completing that one
+    // through removeTask() or completeTopK() queues the following occurrence (the first
+    // one due after now, so missed ones are skipped) at the completed one's priority,
+    // while remove() ends the series. Without a due date the series starts now. Returns
+    // the first occurrence's ID, or kNoTaskId if the list is full.
+    TaskId insertRecurring(int priority, const std::string& desc, const std::string& dueDate,
+                           Recurrence every);
+    // The rule a task was queued by, if it is an occurrence of a recurring task.
+    std::optional<Recurrence> recurrence(TaskId id) const;
     void removeTask();
     void peekTask() const;
-    void displayTasks() const;
+    // Prints tasks in priority order, skipping the first `offset`; pages show a footer
+    // with the range shown. Costs what walking offset + limit tasks byPriority() costs,
+    // independent of the list size.
+    void displayTasks(std::size_t offset = 0, std::size_t limit = kAllTasks) const;
     void saveToFile(const std::string& filename) const;
-    void loadFromFile(const std::string& filename);
+    // Parses large files on several threads (see src/text_loader.cpp).
+    LoadStats loadFromFile(const std::string& filename);
     void exportToCSV(const std::string& filename) const;
+    // Adds the rows of a CSV file laid out as exportToCSV writes it (priority, added, due,
+    // description; a header line is skipped) to the list, until it is full. Fields may be
+    // quoted, with quotes inside doubled; an empty added time means now, an empty due date
+    // none. Rows that do not parse are skipped and reported. See src/csv_import.cpp.
+    ImportStats importFromCSV(const std::string& filename);
+    // Writes every task, in the queue's storage order, as CSV, NDJSON or a columnar binary file (layouts
+    // in src/export.cpp). Rows are formatted in chunks on up to `threads` threads (0: one
+    // per core) and written in order. Returns false if the file could not be written.
+    bool exportTasks(const std::string& filename, ExportFormat format, unsigned threads = 0) const;
     void remindUrgentTasks() const;
+    // Keeps `scheduler` in step with the list from now on: every task with a due date is
+    // scheduled now, and inserts, removals and loads update it as they happen. The
+    // scheduler must outlive the list or be detached with nullptr first; one scheduler
+    // serves one list, since task IDs are per list.
+    void attachReminders(ReminderScheduler* scheduler);
+
+    // Bulk paths for tools that feed or drain the list: each prints one summary line
+    // instead of a line per task. insertTasks() adds tasks in order until the list is
+    // full and returns the IDs of those added; a batch at least as large as the list is
+    // appended and ordered once. completeTopK() removes the k most urgent tasks and
+    // returns them, most urgent first.
+    std::vector<TaskId> insertTasks(const std::vector<NewTask>& tasks);
+    std::vector<Task> completeTopK(std::size_t k);
+
+    // The k most urgent tasks, most urgent first, without changing the list.
+    std::vector<TaskView> topK(std::size_t k) const;
+    // Lazily walks the tasks in priority order, ties as the queue breaks them; stepping
+    // k tasks costs O(k log k) on the heap, O(k) on buckets. Any change to the list
+    // invalidates the walk.
+    PriorityRange byPriority() const;
+
+    // Tasks whose description contains every whitespace-separated term of `query`,
+    // ignoring ASCII case (so a term also matches as a word prefix), most urgent first.
+    // Backed by a trigram index kept up to date on every change; terms shorter than
+    // three characters are only checked against the candidates the others produce.
+    std::vector<TaskView> search(std::string_view query, std::size_t limit = kAllTasks) const;
+    // Tasks matching every bound of `q`, most urgent first (priority, then ID). With a
+    // `limit`, the most urgent matches; as with topK(), which of several equally urgent
+    // tasks make the cut is up to the plan. Planned over three sorted indexes (the queue
+    // for priority, the due index and the creation index; see src/query.cpp), so the
+    // cost follows the most selective bound the query sets, not the list size.
+    std::vector<TaskView> query(const TaskQuery& q, std::size_t limit = kAllTasks) const;
+
+    // Dependencies. A task with a prerequisite still in the list waits outside the queue:
+    // peekTask(), removeTask(), completeTopK(), topK(), byPriority() and query() see
+    // ready tasks only, while get(), search(), size(), displayTasks() (after the ready
+    // ones), saving and exports see every task. Completing or removing a task releases
+    // the tasks that wait on it, queueing each that has nothing left to wait for, in
+    // O(dependents log n); nothing else is recomputed. addDependency() returns false if
+    // either ID is unknown, they are the same, the edge exists or it would close a cycle;
+    // the cycle check searches only the part of the graph the edge reorders (see
+    // src/dependencies.cpp). Snapshots and the journal keep the edges; the text and CSV
+    // formats have no IDs to refer to, so they drop them.
+    bool addDependency(TaskId task, TaskId prerequisite);
+    // As above, edge by edge, with one summary line; returns how many were added.
+    std::size_t addDependencies(const std::vector<Dependency>& edges);
+    // The prerequisites `id` still waits for; empty if it is ready or unknown.
+    std::vector<TaskId> prerequisites(TaskId id) const;
+    // Tasks in the queue: size() less the ones waiting on prerequisites.
+    std::size_t readyCount() const { return queue_.size(); }
+
+    // Access to any task by ID. get() is O(1); updatePriority() and remove() cost a
+    // queue update, O(log n) on the heap. They return nullopt/false when no task has
+    // that ID. A bounded queue stores (and reports) an out-of-range priority clamped.
+    std::optional<TaskView> get(TaskId id) const;
+    bool updatePriority(TaskId id, int priority);
+    bool remove(TaskId id);
+
+    std::size_t size() const { return queue_.size() + blocked_.size(); }
+    // Approximate bytes held by the task storage and its indexes.
+    std::size_t memoryUsage() const;
+
+    // Versioned binary snapshot (see src/snapshot.cpp). Loads through mmap and keeps the
+    // stored queue order, so it is the fast startup path; the text format above remains
+    // the import/export path. Both return false and leave the list untouched on failure.
+    bool saveSnapshot(const std::string& filename) const;
+    bool loadSnapshot(const std::string& filename);
+
+    // Write-ahead journaling: loads the snapshot at snapshotPath if there is one (otherwise
+    // the current contents are the base), replays the journal on top, then logs every
+    // insert, remove and priority change. The journal is compacted into the snapshot in
+    // the background once it grows past JournalOptions::compactBytes or gets older than
+    // compactInterval.
+    bool openJournal(const std::string& snapshotPath, const std::string& journalPath,
+                     const JournalOptions& options = JournalOptions());
+    // Writes the snapshot synchronously and truncates the journal.
+    bool checkpoint();
+    // Starts the same compaction in the background and returns at once: the list is
+    // frozen copy-on-write in O(size / page size + recurring tasks + dependency edges),
+    // then encoded and written (temp file, fsync, rename) on another thread while the
+    // list keeps changing. False if no journal is open.
+    bool checkpointInBackground();
 
 private:
-    std::vector<Task> tasks_;
+    // Tasks live in per-slot columns; a removed task's slot is reused by the next insert.
+    // The queue orders slots and holds their priorities, so reordering never touches
+    // descriptions or times. Tasks waiting on prerequisites sit in blocked_, a second
+    // queue of the same kind, which holds their priorities until they are released.
+
+    // What a snapshot needs, shared copy-on-write with the live columns so it can be
+    // encoded on another thread. Descriptions are not copied: while a background save
+    // holds one of these, released descriptions are parked in deferredFrees_.
+    struct FrozenList {
+        typename Queue::Frozen queue;
+        typename Queue::Frozen blocked;
+        CowVector<TaskId> ids;
+        CowVector<std::int64_t> created;
+        CowVector<std::int64_t> due;
+        CowVector<const char*> descs;
+        std::vector<std::pair<TaskId, Recurrence>> rules; // copied: one entry per rule
+        std::vector<Dependency> edges; // copied; may name prerequisites already done
+        std::uint64_t lsn;
+        TaskId nextId;
+    };
+
+    // Dependency edges of one slot, both ways, by task ID. An entry naming a task that
+    // has left the list is skipped when met rather than searched out on removal; a
+    // task's prerequisites are dropped together once none is left.
+    struct Links {
+        std::vector<TaskId> dependents;
+        std::vector<TaskId> prerequisites;
+        std::uint32_t pending = 0; // prerequisites still in the list
+        std::uint64_t order = 0;   // topological label: below every dependent's
+    };
+    enum class LinkResult { Added, Exists, Cycle };
+
+    TaskView view(std::uint32_t slot) const;
+    bool isBlocked(std::uint32_t slot) const { return slot < links_.size() && links_[slot].pending; }
+    int priorityOf(std::uint32_t slot) const {
+        return isBlocked(slot) ? blocked_.priority(slot) : queue_.priority(slot);
+    }
+    // Every (slot, priority), ready tasks first.
+    template <typename Visit>
+    void forEachTask(Visit visit) const {
+        queue_.forEach(visit);
+        blocked_.forEach(visit);
+    }
+    std::time_t created(std::uint32_t slot) const { return static_cast<std::time_t>(created_[slot]); }
+    std::time_t due(std::uint32_t slot) const { return static_cast<std::time_t>(due_[slot]); }
+    TaskId pushTask(int priority, std::string_view desc, std::time_t created,
+                    std::time_t dueTime, TaskId id);
+    std::uint32_t storeTask(TaskId id, std::string_view desc, std::time_t created,
+                            std::time_t dueTime);
+    // Unlinks the task in `slot` from the queue and indexes; its columns stay readable
+    // until releaseSlot().
+    void unlinkTask(std::uint32_t slot);
+    // Gives links_ an entry for every slot, labelled in the order the tasks were added.
+    void growLinks();
+    LinkResult linkTasks(std::uint32_t task, std::uint32_t prerequisite);
+    bool reorderForEdge(std::uint32_t task, std::uint32_t prerequisite);
+    // Queues the tasks waiting only on the one in `slot`, which is leaving the list.
+    void releaseDependents(std::uint32_t slot);
+    void restoreDependencies(const std::vector<Dependency>& edges);
+    // Queues the occurrence that follows one due at `lastDue`, just completed.
+    void queueNextOccurrence(int priority, std::string_view desc, std::time_t lastDue, Recurrence every);
+    void releaseSlot(std::uint32_t slot);
+    void clearTasks();
+    void appendSlot(TaskId id, int priority, const char* desc, std::time_t created,
+                    std::time_t dueTime);
+    void finishLoad();
+    void rebuildSearchIndex();
+    void logInsert(std::uint32_t slot);
+    void logRemove(TaskId id);
+    void logUpdate(TaskId id, int priority);
+    void logDepend(TaskId task, TaskId prerequisite);
+    void maybeCompact();
+    bool startCompaction();
+    std::shared_ptr<const FrozenList> freeze() const;
+    void applyJournalRecord(const JournalRecord& r);
+    void formatRows(ExportFormat format, const std::uint32_t* begin, const std::uint32_t* end,
+                    std::string& out) const;
+    bool writeColumns(std::ostream& file) const;
+    static std::string encodeSnapshot(const FrozenList& list);
+    static bool writeSnapshot(const std::string& image, const std::string& filename);
+
+    std::ostream* out_ = &std::cout;
+    std::size_t maxTasks_ = kDefaultMaxTasks;
+
+    CowVector<TaskId> ids_;
+    CowVector<std::int64_t> created_;
+    CowVector<std::int64_t> due_;
+    CowVector<const char*> descs_; // StringArena handles
+    std::vector<std::uint32_t> freeSlots_;
+    StringArena arena_;
+    std::weak_ptr<const FrozenList> saving_; // a background save in progress
+    std::vector<const char*> deferredFrees_;
+
+    Queue queue_;
+    Queue blocked_;
+    std::vector<Links> links_; // by slot; empty until the first dependency
+    std::uint64_t nextOrder_ = 0;
+    std::unordered_map<TaskId, std::uint32_t> slotOf_;
+    TaskId nextId_ = 1;
+    // (due time, slot), ordered so overdue/due-soon lookups are range queries
+    std::set<std::pair<std::time_t, std::uint32_t>> dueIndex_;
+    std::set<std::pair<std::time_t, std::uint32_t>> createdIndex_; // (creation time, slot)
+    SearchIndex searchIndex_;
+    // recurring tasks, by the ID of their queued occurrence; sized by rules, not by
+    // future occurrences
+    std::unordered_map<TaskId, Recurrence> rules_;
+    ReminderScheduler* reminders_ = nullptr;
+
+    std::unique_ptr<Journal> journal_;
+    std::string snapshotPath_;
+    std::uint64_t lsn_ = 0; // last journaled operation reflected in the list
+};
+
+// Input iterator over a list in priority order, stepping the queue's Walk.
+template <typename Queue>
+class BasicToDoList<Queue>::PriorityIterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = TaskView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const TaskView*;
+    using reference = TaskView;
+
+    PriorityIterator() = default; // the end
+    TaskView operator*() const { return list_->view(walk_.slot()); }
+    PriorityIterator& operator++() {
+        walk_.next();
+        return *this;
+    }
+    bool operator==(const PriorityIterator& other) const { return walk_.done() && other.walk_.done(); }
+    bool operator!=(const PriorityIterator& other) const { return !(*this == other); }
+
+private:
+    friend class BasicToDoList;
+    explicit PriorityIterator(const BasicToDoList& list) : list_(&list), walk_(list.queue_) {}
+
+    const BasicToDoList* list_ = nullptr;
+    typename Queue::Walk walk_;
 };
 
+template <typename Queue>
+class BasicToDoList<Queue>::PriorityRange {
+public:
+    PriorityIterator begin() const { return PriorityIterator(*list_); }
+    PriorityIterator end() const { return PriorityIterator(); }
+
+private:
+    friend class BasicToDoList;
+    explicit PriorityRange(const BasicToDoList& list) : list_(&list) {}
+    const BasicToDoList* list_;
+};
+
+using PriorityBuckets = BucketQueue<kMinPriority, kMaxPriority>;
+// Any int priority; ties come out in no particular order.
+using ToDoList = BasicToDoList<HeapQueue>;
+// Priorities kMinPriority..kMaxPriority, O(1) per operation, ties first in, first out.
+// The app's lists use this one.
+using BucketToDoList = BasicToDoList<PriorityBuckets>;
+
 } // namespace smarttodo
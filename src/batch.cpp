@@ -0,0 +1,263 @@
+#include "../include/batch.h"
+#include "../include/metrics.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace smarttodo {
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+    const char* space = " \t\r\n";
+    std::size_t first = s.find_first_not_of(space);
+    if (first == std::string_view::npos) return {};
+    return s.substr(first, s.find_last_not_of(space) - first + 1);
+}
+
+// Splits off the first whitespace-separated word of `rest`.
+std::string_view nextWord(std::string_view& rest) {
+    rest = trim(rest);
+    std::size_t end = rest.find_first_of(" \t");
+    std::string_view word = rest.substr(0, end);
+    rest = end == std::string_view::npos ? std::string_view() : trim(rest.substr(end));
+    return word;
+}
+
+template <typename T>
+bool parseNumber(std::string_view text, T& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool parsePriority(std::string_view text, int& priority) {
+    return parseNumber(text, priority) && priority >= kMinPriority && priority <= kMaxPriority;
+}
+
+} // namespace
+
+template <typename List>
+bool runBatchCommand(List& list, std::string_view line, std::ostream& out, std::string& error) {
+    std::string_view rest = line;
+    const std::string_view command = nextWord(rest);
+    if (command.empty() || command.front() == '#') return true;
+    int priority = 0;
+    TaskId id = 0;
+
+    if (command == "add" || command == "repeat") {
+        std::optional<Recurrence> rule;
+        if (command == "repeat" && !(rule = parseRecurrence(nextWord(rest)))) {
+            error = "expected: repeat <every, e.g. 1d 2w 1m> <priority 1-5> <description> [| <due date>]";
+            return false;
+        }
+        if (!parsePriority(nextWord(rest), priority) || rest.empty()) {
+            error = rule ? "expected: repeat <every> <priority 1-5> <description> [| <due date>]"
+                         : "expected: add <priority 1-5> <description> [| <due date>]";
+            return false;
+        }
+        std::string_view due;
+        std::size_t bar = rest.rfind('|');
+        if (bar != std::string_view::npos) {
+            due = trim(rest.substr(bar + 1));
+            rest = trim(rest.substr(0, bar));
+        }
+        TaskId added = rule ? list.insertRecurring(priority, std::string(rest), std::string(due), *rule)
+                            : list.insertTask(priority, std::string(rest), std::string(due));
+        if (added == kNoTaskId) {
+            error = "task list full";
+            return false;
+        }
+    } else if (command == "remove") {
+        list.removeTask();
+    } else if (command == "peek") {
+        list.peekTask();
+    } else if (command == "delete") {
+        if (!parseNumber(nextWord(rest), id)) {
+            error = "expected: delete <id>";
+            return false;
+        }
+        if (!list.remove(id)) {
+            error = "no task with ID " + std::to_string(id);
+            return false;
+        }
+    } else if (command == "update") {
+        if (!parseNumber(nextWord(rest), id) || !parsePriority(nextWord(rest), priority)) {
+            error = "expected: update <id> <priority 1-5>";
+            return false;
+        }
+        if (!list.updatePriority(id, priority)) {
+            error = "no task with ID " + std::to_string(id);
+            return false;
+        }
+    } else if (command == "depend") {
+        TaskId prerequisite = 0;
+        if (!parseNumber(nextWord(rest), id) || !parseNumber(nextWord(rest), prerequisite) || !rest.empty()) {
+            error = "expected: depend <id> <prerequisite id>";
+            return false;
+        }
+        for (TaskId named : {id, prerequisite}) {
+            if (!list.get(named)) {
+                error = "no task with ID " + std::to_string(named);
+                return false;
+            }
+        }
+        if (!list.addDependency(id, prerequisite)) {
+            error = "task " + std::to_string(id) + " cannot wait for task " + std::to_string(prerequisite) +
+                    " (it already does, or that would make a cycle)";
+            return false;
+        }
+    } else if (command == "view") {
+        std::size_t offset = 0;
+        std::size_t limit = List::kAllTasks;
+        std::string_view first = nextWord(rest);
+        std::string_view second = nextWord(rest);
+        if ((!first.empty() && !parseNumber(first, offset)) ||
+            (!second.empty() && !parseNumber(second, limit))) {
+            error = "expected: view [offset [limit]]";
+            return false;
+        }
+        list.displayTasks(offset, limit);
+    } else if (command == "search") {
+        std::vector<TaskView> found = list.search(rest);
+        if (found.empty()) out << "No matching tasks\n";
+        for (const auto& task : found) {
+            out << "ID: " << task.id << " | Priority: " << task.priority << " | Task: " << task.description
+                << "\n";
+        }
+    } else if (command == "export") {
+        if (rest.empty()) {
+            error = "expected: export <file>";
+            return false;
+        }
+        list.exportToCSV(std::string(rest));
+    } else if (command == "import") {
+        if (rest.empty()) {
+            error = "expected: import <file>";
+            return false;
+        }
+        ImportStats stats = list.importFromCSV(std::string(rest));
+        if (!stats.errors.empty() && stats.errors.front().line == 0) {
+            error = stats.errors.front().reason;
+            return false;
+        }
+        for (const auto& e : stats.errors) out << rest << ":" << e.line << ": " << e.reason << "\n";
+    } else if (command == "remind") {
+        list.remindUrgentTasks();
+    } else if (command == "stats") {
+        metrics::writeTable(out, metrics::snapshot());
+    } else if (command == "save") {
+        if (!list.checkpointInBackground()) {
+            error = "no journal open";
+            return false;
+        }
+    } else {
+        error = "unknown command '" + std::string(command) + "'";
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+template <typename RunCommand>
+BatchStats runLines(std::istream& in, std::ostream& out, RunCommand run) {
+    BatchStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    std::string line;
+    std::string error;
+    for (std::size_t lineNo = 1; std::getline(in, line); ++lineNo) {
+        std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#') continue;
+        ++stats.commands;
+        if (!run(text, error)) {
+            ++stats.failed;
+            out << "Line " << lineNo << ": " << error << "\n";
+        }
+    }
+    stats.elapsed = std::chrono::steady_clock::now() - start;
+    return stats;
+}
+
+} // namespace
+
+template <typename List>
+BatchStats runBatch(List& list, std::istream& in, std::ostream& out) {
+    return runLines(in, out, [&](std::string_view line, std::string& error) {
+        return runBatchCommand(list, line, out, error);
+    });
+}
+
+template bool runBatchCommand(ToDoList&, std::string_view, std::ostream&, std::string&);
+template bool runBatchCommand(BucketToDoList&, std::string_view, std::ostream&, std::string&);
+template BatchStats runBatch(ToDoList&, std::istream&, std::ostream&);
+template BatchStats runBatch(BucketToDoList&, std::istream&, std::ostream&);
+
+BatchStats runBatch(ListManager& lists, std::istream& in, std::ostream& out) {
+    ListManager::Handle current; // pinned while it is current
+    return runLines(in, out, [&](std::string_view line, std::string& error) {
+        std::string_view rest = line;
+        const std::string_view command = nextWord(rest);
+        if (command == "use") {
+            current = lists.open(std::string(rest));
+            if (!current) error = "cannot open list '" + std::string(rest) + "'";
+            return current != nullptr;
+        }
+        if (command == "top") {
+            std::size_t k = 10;
+            if (!rest.empty() && !parseNumber(rest, k)) {
+                error = "expected: top [k]";
+                return false;
+            }
+            for (const ListTask& task : lists.topUrgent(k)) {
+                out << "List: " << task.list << " | ID: " << task.id << " | Priority: " << task.priority
+                    << " | Task: " << task.description << "\n";
+            }
+            return true;
+        }
+        if (!current) {
+            error = "no list selected; start with: use <name>";
+            return false;
+        }
+        return runBatchCommand(*current, line, out, error);
+    });
+}
+
+BatchOutputBuffer::BatchOutputBuffer(std::streambuf* sink, std::size_t size)
+    : sink_(sink), buffer_(size) {
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+}
+
+BatchOutputBuffer::~BatchOutputBuffer() { drain(); }
+
+void BatchOutputBuffer::drain() {
+    writeBuffered();
+    sink_->pubsync();
+}
+
+bool BatchOutputBuffer::writeBuffered() {
+    std::streamsize n = pptr() - pbase();
+    bool ok = n == 0 || sink_->sputn(pbase(), n) == n;
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+    return ok;
+}
+
+BatchOutputBuffer::int_type BatchOutputBuffer::overflow(int_type ch) {
+    if (!writeBuffered()) return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize BatchOutputBuffer::xsputn(const char* s, std::streamsize n) {
+    if (n > epptr() - pptr()) {
+        if (!writeBuffered()) return 0;
+        // too big to be worth copying: pass straight through
+        if (n >= static_cast<std::streamsize>(buffer_.size())) return sink_->sputn(s, n);
+    }
+    std::memcpy(pptr(), s, static_cast<std::size_t>(n));
+    pbump(static_cast<int>(n));
+    return n;
+}
+
+} // namespace smarttodo
@@ -0,0 +1,164 @@
+#include "../include/concurrent_todo.h"
+#include "datetime.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace smarttodo {
+
+namespace {
+
+const long long kEmptyShard = std::numeric_limits<long long>::max();
+// IDs are handed to threads in blocks so inserts do not all hit one shared counter.
+const TaskId kIdBlock = 256;
+
+std::atomic<std::uint64_t> nextInstance{1};
+
+// Per-thread xorshift generator; shard choice needs speed, not quality.
+std::uint64_t randomNumber() {
+    thread_local std::uint64_t state =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+        static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+        0x9E3779B97F4A7C15ull;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+} // namespace
+
+struct alignas(64) ConcurrentToDoList::Shard {
+    struct Entry {
+        Task task;
+        std::uint64_t seq; // insertion order within the shard
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Entry> heap;
+    std::uint64_t nextSeq = 0;
+    // priority of the shard's most urgent task, readable without the lock
+    std::atomic<long long> top{kEmptyShard};
+    std::atomic<std::size_t> count{0};
+
+    // std heap algorithms build max-heaps, so "less" means "less urgent"
+    static bool lessUrgent(const Entry& a, const Entry& b) {
+        return a.task.priority != b.task.priority ? a.task.priority > b.task.priority
+                                                  : a.seq > b.seq;
+    }
+
+    void publish() {
+        top.store(heap.empty() ? kEmptyShard : heap.front().task.priority,
+                  std::memory_order_relaxed);
+        count.store(heap.size(), std::memory_order_relaxed);
+    }
+};
+
+ConcurrentToDoList::ConcurrentToDoList(std::size_t shards, std::size_t maxTasks)
+    : shardCount_(shards ? shards
+                         : 2 * std::max<std::size_t>(1, std::thread::hardware_concurrency())),
+      shards_(new Shard[shardCount_]),
+      maxTasks_(maxTasks),
+      instance_(nextInstance.fetch_add(1, std::memory_order_relaxed)) {}
+
+ConcurrentToDoList::~ConcurrentToDoList() = default;
+
+TaskId ConcurrentToDoList::nextId() {
+    struct Block {
+        std::uint64_t instance = 0;
+        TaskId next = 0;
+        TaskId end = 0;
+    };
+    thread_local Block block;
+    if (block.instance != instance_ || block.next == block.end) {
+        block.instance = instance_;
+        block.next = nextIdBlock_.fetch_add(kIdBlock, std::memory_order_relaxed);
+        block.end = block.next + kIdBlock;
+    }
+    return block.next++;
+}
+
+ConcurrentToDoList::Shard& ConcurrentToDoList::pickShard() const {
+    return shards_[randomNumber() % shardCount_];
+}
+
+TaskId ConcurrentToDoList::insertTask(int priority, const std::string& desc,
+                                      const std::string& dueDate) {
+    if (maxTasks_ != kUnbounded &&
+        reserved_.fetch_add(1, std::memory_order_relaxed) >= maxTasks_) {
+        reserved_.fetch_sub(1, std::memory_order_relaxed);
+        return kNoTaskId;
+    }
+    Task task{nextId(), priority, desc, currentMinute(), parseDateTime(dueDate)};
+    const TaskId id = task.id;
+    // a busy shard is skipped rather than waited on, until every shard has had a chance;
+    // then block, so a preempted lock holder is not spun against
+    for (std::size_t attempt = 1;; ++attempt) {
+        Shard& shard = pickShard();
+        std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+        if (attempt > shardCount_) lock.lock();
+        else if (!lock.try_lock()) continue;
+        shard.heap.push_back(Shard::Entry{std::move(task), shard.nextSeq++});
+        std::push_heap(shard.heap.begin(), shard.heap.end(), Shard::lessUrgent);
+        shard.publish();
+        return id;
+    }
+}
+
+// Caller holds the shard's lock.
+std::optional<Task> ConcurrentToDoList::popFrom(Shard& shard) {
+    if (shard.heap.empty()) return std::nullopt;
+    std::pop_heap(shard.heap.begin(), shard.heap.end(), Shard::lessUrgent);
+    Task task = std::move(shard.heap.back().task);
+    shard.heap.pop_back();
+    shard.publish();
+    return task;
+}
+
+std::optional<Task> ConcurrentToDoList::popMin() {
+    std::optional<Task> task;
+    // two random choices: pop from whichever shard looks more urgent
+    for (std::size_t attempt = 0; attempt < 2 * shardCount_ && !task; ++attempt) {
+        Shard& a = pickShard();
+        Shard& b = pickShard();
+        long long topA = a.top.load(std::memory_order_relaxed);
+        long long topB = b.top.load(std::memory_order_relaxed);
+        if (topA == kEmptyShard && topB == kEmptyShard) break; // probably draining: sweep
+        Shard& best = topA <= topB ? a : b;
+        std::unique_lock<std::mutex> lock(best.mutex, std::try_to_lock);
+        if (lock) task = popFrom(best);
+    }
+    for (std::size_t i = 0; i < shardCount_ && !task; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        task = popFrom(shards_[i]);
+    }
+    if (task && maxTasks_ != kUnbounded) reserved_.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+}
+
+std::optional<Task> ConcurrentToDoList::peekMin() const {
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < shardCount_; ++i) {
+        if (shards_[i].top.load(std::memory_order_relaxed) <
+            shards_[best].top.load(std::memory_order_relaxed)) {
+            best = i;
+        }
+    }
+    std::lock_guard<std::mutex> lock(shards_[best].mutex);
+    if (shards_[best].heap.empty()) return std::nullopt;
+    return shards_[best].heap.front().task;
+}
+
+std::size_t ConcurrentToDoList::size() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < shardCount_; ++i) {
+        total += shards_[i].count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+} // namespace smarttodo
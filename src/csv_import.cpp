@@ -0,0 +1,275 @@
+#include "../include/todo.h"
+#include "../include/metrics.h"
+#include "datetime.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <deque>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace smarttodo {
+
+// CSV import. The mapped file is scanned once, 16 bytes at a time, for the characters
+// that end an unquoted field (',' '\n') or matter inside a quoted one ('"' '\n'); the
+// bytes in between are never looked at one by one. Fields are views into the mapping,
+// and a description is copied only into the list's arena, except the rare one with
+// doubled quotes, which is unescaped first. Rows are parsed before any is stored, so
+// the list is untouched until the whole file has been read, and stored as insertTasks()
+// stores a batch: appended and ordered once when the batch is at least as large as
+// the list.
+namespace {
+
+const std::size_t kFields = 4; // priority, added, due, description
+const std::size_t kQuotedTextMax = 40; // of a bad field, in an error message
+
+// First occurrence of `a` or `b` in [p, end), or end.
+const char* findEither(const char* p, const char* end, char a, char b) {
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+    for (; end - p >= 16; p += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, va), _mm_cmpeq_epi8(block, vb))));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == a || *p == b) return p;
+    }
+    return end;
+}
+
+struct Field {
+    std::string_view text;
+    bool escaped = false; // quoted, with doubled quotes still in `text`
+};
+
+struct Row {
+    std::size_t line;
+    int priority;
+    std::time_t created;
+    std::time_t due;
+    std::string_view description;
+};
+
+// Walks the file row by row, counting lines (quoted fields may span several).
+class CsvCursor {
+public:
+    CsvCursor(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    bool done() const { return p_ == end_; }
+    std::size_t line() const { return line_; }
+
+    // Steps over an empty line; false if the next line has something on it.
+    bool skipBlankLine() {
+        const char* q = p_;
+        if (q < end_ && *q == '\r') ++q;
+        if (q == end_ || *q != '\n') return false;
+        p_ = q + 1;
+        ++line_;
+        return true;
+    }
+
+    // Reads the next row into `fields` (the first kFields of them; `count` says how many
+    // there were). On a malformed row, returns why and leaves the cursor past it.
+    const char* readRow(Field* fields, std::size_t& count) {
+        count = 0;
+        for (;;) {
+            Field field;
+            if (p_ < end_ && *p_ == '"') {
+                if (const char* error = readQuoted(field)) return error;
+            } else {
+                const char* stop = findEither(p_, end_, ',', '\n');
+                field.text = std::string_view(p_, static_cast<std::size_t>(stop - p_));
+                if (stop != end_ && *stop == '\n' && !field.text.empty() && field.text.back() == '\r') {
+                    field.text.remove_suffix(1);
+                }
+                p_ = stop;
+            }
+            if (count < kFields) fields[count] = field;
+            ++count;
+            if (p_ == end_) return nullptr;
+            if (*p_++ == '\n') {
+                ++line_;
+                return nullptr;
+            }
+        }
+    }
+
+private:
+    const char* readQuoted(Field& field) {
+        const char* start = ++p_;
+        for (;;) {
+            const char* q = findEither(p_, end_, '"', '\n');
+            if (q == end_) {
+                p_ = end_;
+                return "unterminated quoted field";
+            }
+            p_ = q + 1;
+            if (*q == '\n') {
+                ++line_;
+            } else if (p_ < end_ && *p_ == '"') {
+                field.escaped = true;
+                ++p_;
+            } else {
+                field.text = std::string_view(start, static_cast<std::size_t>(q - start));
+                break;
+            }
+        }
+        if (p_ < end_ && *p_ == '\r' && p_ + 1 < end_ && p_[1] == '\n') ++p_;
+        if (p_ == end_ || *p_ == ',' || *p_ == '\n') return nullptr;
+        skipLine();
+        return "text after a closing quote";
+    }
+
+    void skipLine() {
+        const char* nl = static_cast<const char*>(std::memchr(p_, '\n', static_cast<std::size_t>(end_ - p_)));
+        p_ = nl ? nl + 1 : end_;
+        if (nl) ++line_;
+    }
+
+    const char* p_;
+    const char* end_;
+    std::size_t line_ = 1;
+};
+
+std::string_view trimSpaces(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+bool parseInt(std::string_view text, int& value) {
+    text = trimSpaces(text);
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// Exported files repeat the same few times row after row (tasks added in the same
+// minute), so the last one parsed is remembered.
+class TimeParser {
+public:
+    // False if `text` is neither empty nor a time; empty gives `absent`.
+    bool parse(std::string_view text, std::time_t absent, std::time_t& time) {
+        text = trimSpaces(text);
+        if (text.empty()) {
+            time = absent;
+            return true;
+        }
+        if (text != last_) {
+            lastTime_ = parseDateTime(text);
+            last_ = text;
+        }
+        time = lastTime_;
+        return time != kNoTime;
+    }
+
+private:
+    std::string_view last_;
+    std::time_t lastTime_ = kNoTime;
+};
+
+std::string unescape(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        out += text[i];
+        if (text[i] == '"') ++i; // the second of a doubled pair
+    }
+    return out;
+}
+
+std::string quoted(std::string_view text) {
+    std::string out = "'";
+    out.append(text.data(), std::min(text.size(), kQuotedTextMax));
+    if (text.size() > kQuotedTextMax) out += "...";
+    return out + "'";
+}
+
+void reject(ImportStats& stats, std::size_t line, std::string reason) {
+    ++stats.rejected;
+    if (stats.errors.size() < ImportStats::kMaxErrors) stats.errors.push_back(ImportError{line, std::move(reason)});
+}
+
+} // namespace
+
+template <typename Queue>
+ImportStats BasicToDoList<Queue>::importFromCSV(const std::string& filename) {
+    SMARTTODO_TIME(Load);
+    ImportStats stats;
+    MappedFile file;
+    if (!file.open(filename)) {
+        stats.errors.push_back(ImportError{0, "cannot read " + filename});
+        return stats;
+    }
+
+    const std::time_t now = currentMinute();
+    CsvCursor cursor(file.data(), file.data() + file.size());
+    std::vector<Row> rows;
+    std::deque<std::string> unescaped; // descriptions that had doubled quotes
+    TimeParser added, due;
+    Field fields[kFields];
+    std::size_t count;
+    while (!cursor.done()) {
+        if (cursor.skipBlankLine()) continue;
+        const std::size_t line = cursor.line();
+        if (const char* error = cursor.readRow(fields, count)) {
+            reject(stats, line, error);
+            continue;
+        }
+        Row row{line, 0, now, kNoTime, fields[kFields - 1].text};
+        if (count != kFields) {
+            reject(stats, line, "expected 4 fields, found " + std::to_string(count));
+        } else if (!parseInt(fields[0].text, row.priority)) {
+            if (line != 1) reject(stats, line, "priority " + quoted(fields[0].text) + " is not a number");
+            // else the header
+        } else if (!added.parse(fields[1].text, now, row.created)) {
+            reject(stats, line, "added time " + quoted(fields[1].text) + " does not parse");
+        } else if (!due.parse(fields[2].text, kNoTime, row.due)) {
+            reject(stats, line, "due date " + quoted(fields[2].text) + " does not parse");
+        } else {
+            if (fields[3].escaped) row.description = unescaped.emplace_back(unescape(fields[3].text));
+            rows.push_back(row);
+        }
+    }
+
+    const std::size_t room = size() < maxTasks_ ? maxTasks_ - size() : 0;
+    const std::size_t take = std::min(rows.size(), room);
+    for (std::size_t i = take; i < rows.size(); ++i) reject(stats, rows[i].line, "task list full");
+    // as in insertTasks(): one ordering pass beats pushes once the batch is as large as the list
+    const bool rebuild = take >= queue_.size();
+    const std::size_t total = queue_.size() + take;
+    ids_.reserve(total);
+    created_.reserve(total);
+    due_.reserve(total);
+    descs_.reserve(total);
+    queue_.reserve(total);
+    std::vector<std::uint32_t> slots;
+    slots.reserve(take);
+    for (std::size_t i = 0; i < take; ++i) {
+        const Row& r = rows[i];
+        std::uint32_t slot = storeTask(kNoTaskId, r.description, r.created, r.due);
+        if (rebuild) queue_.append(slot, r.priority);
+        else queue_.push(slot, r.priority);
+        slots.push_back(slot);
+    }
+    if (rebuild) queue_.restore();
+    for (std::uint32_t slot : slots) logInsert(slot); // after restore, so a compaction sees an ordered queue
+    stats.imported = take;
+
+    *out_ << "Imported " << stats.imported << " tasks";
+    if (stats.rejected) *out_ << " (" << stats.rejected << " rows skipped)";
+    *out_ << std::endl;
+    return stats;
+}
+
+template ImportStats BasicToDoList<HeapQueue>::importFromCSV(const std::string&);
+template ImportStats BasicToDoList<PriorityBuckets>::importFromCSV(const std::string&);
+
+} // namespace smarttodo
@@ -0,0 +1,232 @@
+#include "datetime.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace smarttodo {
+
+std::time_t currentMinute() {
+#if defined(CLOCK_REALTIME_COARSE)
+    // the coarse clock is the time of the last tick, read without touching the hardware
+    timespec ts;
+    std::time_t now = clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0 ? ts.tv_sec : std::time(nullptr);
+#else
+    std::time_t now = std::time(nullptr);
+#endif
+    return now - now % 60;
+}
+
+// Reads 1 to `maxDigits` digits at p, advancing it.
+static bool readNumber(const char*& p, const char* end, int maxDigits, int& value) {
+    const char* start = p;
+    value = 0;
+    while (p < end && p - start < maxDigits && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+    return p > start;
+}
+
+static bool expect(const char*& p, const char* end, char c) {
+    if (p == end || *p != c) return false;
+    ++p;
+    return true;
+}
+
+// Hand-written in place of get_time, which goes through the stream locale, and with
+// mktime run once per distinct (date, hour) and thread: mktime takes the global
+// timezone lock, which serialized the parallel loader's threads.
+std::time_t parseDateTime(std::string_view text) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    int year, month, day, hour, minute;
+    if (!readNumber(p, end, 4, year) || !expect(p, end, '-') || !readNumber(p, end, 2, month) ||
+        !expect(p, end, '-') || !readNumber(p, end, 2, day)) {
+        return kNoTime;
+    }
+    const char* dateEnd = p;
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    if (p == end) {
+        hour = minute = 0; // a date alone means its midnight, as get_time read it
+    } else if (p == dateEnd || !readNumber(p, end, 2, hour) || !expect(p, end, ':') ||
+               !readNumber(p, end, 2, minute)) {
+        return kNoTime;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59) return kNoTime;
+
+    thread_local std::unordered_map<long, std::time_t> hourStarts;
+    long key = ((static_cast<long>(year) * 100 + month) * 100 + day) * 100 + hour;
+    auto it = hourStarts.find(key);
+    if (it == hourStarts.end()) {
+        std::tm tm = {};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_isdst = -1; // let mktime decide whether DST applies
+        std::time_t start = std::mktime(&tm);
+        if (start == static_cast<std::time_t>(-1)) return kNoTime;
+        if (hourStarts.size() >= 65536) hourStarts.clear(); // keep the cache bounded
+        it = hourStarts.emplace(key, start).first;
+    }
+    return it->second + static_cast<std::time_t>(minute) * 60;
+}
+
+// Civil date <-> days since 1970-01-01 in the proleptic Gregorian calendar.
+static long daysFromCivil(long y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const long era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long>(doe) - 719468;
+}
+
+static void civilFromDays(long z, long& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const long era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<long>(yoe) + era * 400 + (m <= 2);
+}
+
+static long floorDiv(long a, long b) { return a / b - (a % b < 0); }
+
+// Local time minus UTC at `t`, in seconds.
+static bool localOffset(std::time_t t, long& offset) {
+    std::tm ltm;
+#if defined(_WIN32)
+    if (localtime_s(&ltm, &t) != 0) return false;
+#else
+    if (!localtime_r(&t, &ltm)) return false;
+#endif
+    long local = daysFromCivil(ltm.tm_year + 1900L, ltm.tm_mon + 1, ltm.tm_mday) * 86400 +
+                 ltm.tm_hour * 3600L + ltm.tm_min * 60L + ltm.tm_sec;
+    offset = local - static_cast<long>(t);
+    return true;
+}
+
+// localtime takes the same timezone lock as mktime and costs about a microsecond, which
+// dominated listing and saving. The UTC offset is looked up once per UTC day (and
+// thread) instead; days that contain an offset change take the slow path. Recently
+// formatted minutes are kept as well, since inserts format the current minute over and
+// over and tasks added together share their added (and often due) times.
+std::size_t formatDateTime(std::time_t time, char* out) {
+    if (time == kNoTime) return 0;
+    struct FormattedMinute {
+        long minute = std::numeric_limits<long>::min();
+        char text[kDateTimeLength];
+    };
+    thread_local FormattedMinute recent[16];
+    const long minute = floorDiv(static_cast<long>(time), 60);
+    FormattedMinute& last = recent[static_cast<unsigned long>(minute) % 16];
+    if (minute == last.minute) {
+        std::memcpy(out, last.text, kDateTimeLength);
+        return kDateTimeLength;
+    }
+
+    struct DayOffset {
+        long day = std::numeric_limits<long>::min();
+        long offset = 0;
+    };
+    thread_local DayOffset cache[64];
+    const long day = floorDiv(static_cast<long>(time), 86400);
+    DayOffset& entry = cache[static_cast<unsigned long>(day) % 64];
+    long offset;
+    if (entry.day == day) {
+        offset = entry.offset;
+    } else {
+        long endOffset;
+        if (!localOffset(static_cast<std::time_t>(day * 86400), offset) ||
+            !localOffset(static_cast<std::time_t>(day * 86400 + 86399), endOffset)) {
+            return 0;
+        }
+        if (offset == endOffset) entry = DayOffset{day, offset};
+        else if (!localOffset(time, offset)) return 0;
+    }
+
+    const long local = static_cast<long>(time) + offset;
+    const long days = floorDiv(local, 86400);
+    const long secs = local - days * 86400;
+    long year;
+    unsigned month, mday;
+    civilFromDays(days, year, month, mday);
+    if (year < 0 || year > 9999) return 0;
+    char* buf = last.text;
+    auto put2 = [buf](int pos, long v) {
+        buf[pos] = static_cast<char>('0' + v / 10);
+        buf[pos + 1] = static_cast<char>('0' + v % 10);
+    };
+    put2(0, year / 100);
+    put2(2, year % 100);
+    buf[4] = '-';
+    put2(5, month);
+    buf[7] = '-';
+    put2(8, mday);
+    buf[10] = ' ';
+    put2(11, secs / 3600);
+    buf[13] = ':';
+    put2(14, secs / 60 % 60);
+    last.minute = minute;
+    std::memcpy(out, buf, kDateTimeLength);
+    return kDateTimeLength;
+}
+
+std::string formatDateTime(std::time_t time) {
+    char buf[kDateTimeLength];
+    return std::string(buf, formatDateTime(time, buf));
+}
+
+static const char kUnitLetters[] = {'d', 'w', 'm'};
+
+std::optional<Recurrence> parseRecurrence(std::string_view text) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    int count;
+    if (!readNumber(p, end, 4, count) || count < 1 || end - p != 1) return std::nullopt;
+    for (std::uint8_t unit = 0; unit < sizeof(kUnitLetters); ++unit) {
+        if (*p == kUnitLetters[unit]) {
+            return Recurrence{static_cast<Recurrence::Unit>(unit), static_cast<std::uint16_t>(count)};
+        }
+    }
+    return std::nullopt;
+}
+
+std::string formatRecurrence(Recurrence r) {
+    return std::to_string(r.every) + kUnitLetters[static_cast<std::uint8_t>(r.unit)];
+}
+
+std::optional<Recurrence> unpackRecurrence(std::uint32_t packed) {
+    const std::uint32_t unit = packed >> 16, count = packed & 0xFFFF;
+    if (unit >= sizeof(kUnitLetters) || count < 1 || count > kMaxRecurrenceCount) return std::nullopt;
+    return Recurrence{static_cast<Recurrence::Unit>(unit), static_cast<std::uint16_t>(count)};
+}
+
+std::time_t advanceTime(std::time_t time, Recurrence step) {
+    std::tm tm;
+#if defined(_WIN32)
+    if (localtime_s(&tm, &time) != 0) return kNoTime;
+#else
+    if (!localtime_r(&time, &tm)) return kNoTime;
+#endif
+    if (step.unit == Recurrence::Unit::Month) {
+        const long months = tm.tm_year * 12L + tm.tm_mon + step.every;
+        const long year = floorDiv(months, 12) + 1900;
+        const unsigned month = static_cast<unsigned>(months - floorDiv(months, 12) * 12) + 1;
+        const long length = month == 12 ? 31 : daysFromCivil(year, month + 1, 1) - daysFromCivil(year, month, 1);
+        tm.tm_year = static_cast<int>(year - 1900);
+        tm.tm_mon = static_cast<int>(month - 1);
+        tm.tm_mday = static_cast<int>(std::min<long>(tm.tm_mday, length));
+    } else {
+        tm.tm_mday += step.every * (step.unit == Recurrence::Unit::Week ? 7 : 1);
+    }
+    tm.tm_isdst = -1; // the wall-clock time stays; mktime decides the offset
+    const std::time_t next = std::mktime(&tm);
+    return next == static_cast<std::time_t>(-1) ? kNoTime : next;
+}
+
+} // namespace smarttodo
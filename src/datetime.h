@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../include/todo.h"
+
+namespace smarttodo {
+
+// Tasks store times as epoch seconds; the text formats spell them "YYYY-MM-DD HH:MM"
+// in local time, so stored times have minute resolution.
+
+// Length of a formatted time.
+constexpr std::size_t kDateTimeLength = 16;
+
+// The current time truncated to the minute, as recorded when a task is added. Reads a
+// coarse clock where there is one, since minutes are all it needs.
+std::time_t currentMinute();
+
+// Accepts "YYYY-MM-DD HH:MM" and looser spellings: unpadded fields, a date alone (its
+// midnight), and trailing text such as the seconds older versions wrote. Returns
+// kNoTime for empty or unparseable input.
+std::time_t parseDateTime(std::string_view text);
+
+// Inverse of parseDateTime: writes kDateTimeLength characters to `out` and returns that,
+// or writes nothing and returns 0 for kNoTime.
+std::size_t formatDateTime(std::time_t time, char* out);
+// As above, as a string; empty for kNoTime.
+std::string formatDateTime(std::time_t time);
+
+// `time` moved on by one step of `step` in local time, so a daily task keeps its hour
+// across DST changes. Returns kNoTime if the result cannot be represented.
+std::time_t advanceTime(std::time_t time, Recurrence step);
+
+// Recurrences as the journal and snapshots store them: unit in the high half, count in
+// the low one. unpackRecurrence rejects what parseRecurrence would.
+inline std::uint32_t packRecurrence(Recurrence r) {
+    return static_cast<std::uint32_t>(r.unit) << 16 | r.every;
+}
+std::optional<Recurrence> unpackRecurrence(std::uint32_t packed);
+
+} // namespace smarttodo
@@ -0,0 +1,222 @@
+#include "../include/todo.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
+namespace smarttodo {
+
+// Task dependencies. A task with prerequisites still in the list is moved from the queue
+// to blocked_, and back once the last of them leaves, so the queue only ever holds
+// tasks that are ready and its operations keep their costs.
+//
+// Cycles are rejected with Pearce and Kelly's dynamic topological order: every slot
+// carries a label, and each prerequisite's label stays below those of its dependents.
+// An edge that agrees with the labels cannot close a cycle and is added in O(1), which
+// is the usual case of tasks linked in the order they were added. Otherwise only the
+// tasks labelled between the two ends can be on a cycle: they are searched forward
+// from the dependent and backward from the prerequisite, and the ones found swap
+// labels among themselves.
+
+template <typename Queue>
+bool BasicToDoList<Queue>::addDependency(TaskId task, TaskId prerequisite) {
+    auto t = slotOf_.find(task);
+    auto p = slotOf_.find(prerequisite);
+    if (t == slotOf_.end() || p == slotOf_.end()) return false;
+    switch (linkTasks(t->second, p->second)) {
+        case LinkResult::Added:
+            break;
+        case LinkResult::Exists:
+            *out_ << "Task " << task << " already waits for task " << prerequisite << std::endl;
+            return false;
+        case LinkResult::Cycle:
+            *out_ << "Task " << task << " cannot wait for task " << prerequisite
+                  << ": that would make a cycle" << std::endl;
+            return false;
+    }
+    logDepend(task, prerequisite);
+    *out_ << "Task " << task << " now waits for task " << prerequisite << std::endl;
+    return true;
+}
+
+template <typename Queue>
+std::size_t BasicToDoList<Queue>::addDependencies(const std::vector<Dependency>& edges) {
+    std::size_t added = 0;
+    for (const Dependency& e : edges) {
+        auto t = slotOf_.find(e.task);
+        auto p = slotOf_.find(e.prerequisite);
+        if (t == slotOf_.end() || p == slotOf_.end()) continue;
+        if (linkTasks(t->second, p->second) != LinkResult::Added) continue;
+        logDepend(e.task, e.prerequisite);
+        ++added;
+    }
+    *out_ << "Added " << added << " dependencies";
+    if (added < edges.size()) *out_ << " (" << edges.size() - added << " skipped)";
+    *out_ << std::endl;
+    return added;
+}
+
+template <typename Queue>
+std::vector<TaskId> BasicToDoList<Queue>::prerequisites(TaskId id) const {
+    std::vector<TaskId> waiting;
+    auto it = slotOf_.find(id);
+    if (it == slotOf_.end() || !isBlocked(it->second)) return waiting;
+    for (TaskId prerequisite : links_[it->second].prerequisites) {
+        if (slotOf_.count(prerequisite)) waiting.push_back(prerequisite);
+    }
+    return waiting;
+}
+
+// Slots follow the queue's order after a load, not the order tasks were added, while
+// tasks mostly wait for older ones; labelling new slots by ID keeps such edges in order.
+template <typename Queue>
+void BasicToDoList<Queue>::growLinks() {
+    if (links_.size() >= ids_.size()) return;
+    std::vector<std::uint32_t> fresh(ids_.size() - links_.size());
+    std::iota(fresh.begin(), fresh.end(), static_cast<std::uint32_t>(links_.size()));
+    std::sort(fresh.begin(), fresh.end(), [this](std::uint32_t a, std::uint32_t b) { return ids_[a] < ids_[b]; });
+    links_.resize(ids_.size());
+    for (std::uint32_t slot : fresh) links_[slot].order = nextOrder_++;
+}
+
+template <typename Queue>
+auto BasicToDoList<Queue>::linkTasks(std::uint32_t task, std::uint32_t prerequisite) -> LinkResult {
+    if (task == prerequisite) return LinkResult::Cycle;
+    growLinks();
+    const TaskId taskId = ids_[task], prerequisiteId = ids_[prerequisite];
+    // either list holds the edge if it exists; entries of tasks gone since cannot match
+    const std::vector<TaskId>& shorter = links_[task].prerequisites.size() <= links_[prerequisite].dependents.size()
+                                             ? links_[task].prerequisites
+                                             : links_[prerequisite].dependents;
+    const TaskId other = &shorter == &links_[task].prerequisites ? prerequisiteId : taskId;
+    if (std::find(shorter.begin(), shorter.end(), other) != shorter.end()) return LinkResult::Exists;
+    if (links_[prerequisite].order > links_[task].order && !reorderForEdge(task, prerequisite)) {
+        return LinkResult::Cycle;
+    }
+
+    Links& t = links_[task];
+    t.prerequisites.push_back(prerequisiteId);
+    links_[prerequisite].dependents.push_back(taskId);
+    if (t.pending++ == 0) {
+        const int priority = queue_.priority(task);
+        queue_.erase(task);
+        blocked_.push(task, priority);
+    }
+    return LinkResult::Added;
+}
+
+// For an edge whose prerequisite is labelled above its task: false if the task already
+// leads to the prerequisite, otherwise relabels the tasks in between so the edge fits.
+template <typename Queue>
+bool BasicToDoList<Queue>::reorderForEdge(std::uint32_t task, std::uint32_t prerequisite) {
+    const std::uint64_t low = links_[task].order, high = links_[prerequisite].order;
+    std::vector<std::uint32_t> forward, backward, stack{task};
+    std::unordered_set<std::uint32_t> seen{task};
+    // labels grow along every path, so one from the task to the prerequisite stays below `high`
+    while (!stack.empty()) {
+        const std::uint32_t slot = stack.back();
+        stack.pop_back();
+        forward.push_back(slot);
+        for (TaskId id : links_[slot].dependents) {
+            auto it = slotOf_.find(id);
+            if (it == slotOf_.end()) continue;
+            if (it->second == prerequisite) return false;
+            if (links_[it->second].order < high && seen.insert(it->second).second) stack.push_back(it->second);
+        }
+    }
+    stack.push_back(prerequisite);
+    seen.insert(prerequisite);
+    while (!stack.empty()) {
+        const std::uint32_t slot = stack.back();
+        stack.pop_back();
+        backward.push_back(slot);
+        for (TaskId id : links_[slot].prerequisites) {
+            auto it = slotOf_.find(id);
+            if (it == slotOf_.end()) continue;
+            if (links_[it->second].order > low && seen.insert(it->second).second) stack.push_back(it->second);
+        }
+    }
+
+    // the prerequisite's ancestors take the lowest of the freed labels, in their old order
+    auto byOrder = [this](std::uint32_t a, std::uint32_t b) { return links_[a].order < links_[b].order; };
+    std::sort(backward.begin(), backward.end(), byOrder);
+    std::sort(forward.begin(), forward.end(), byOrder);
+    std::vector<std::uint64_t> labels;
+    labels.reserve(backward.size() + forward.size());
+    for (std::uint32_t slot : backward) labels.push_back(links_[slot].order);
+    for (std::uint32_t slot : forward) labels.push_back(links_[slot].order);
+    std::sort(labels.begin(), labels.end());
+    std::size_t next = 0;
+    for (std::uint32_t slot : backward) links_[slot].order = labels[next++];
+    for (std::uint32_t slot : forward) links_[slot].order = labels[next++];
+    return true;
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::releaseDependents(std::uint32_t slot) {
+    for (TaskId id : links_[slot].dependents) {
+        auto it = slotOf_.find(id);
+        if (it == slotOf_.end()) continue; // left the list first
+        Links& d = links_[it->second];
+        if (--d.pending) continue;
+        d.prerequisites.clear(); // all of them are done
+        const int priority = blocked_.priority(it->second);
+        blocked_.erase(it->second);
+        queue_.push(it->second, priority);
+    }
+}
+
+// Loading: the edges of a snapshot come in no useful order, so the tasks they connect
+// are labelled in topological order first (Kahn's algorithm) and every edge then fits
+// as it is linked. Edges naming a task that is not in the list are dropped; should a
+// damaged file hold a cycle, linkTasks() drops the edges that close it.
+template <typename Queue>
+void BasicToDoList<Queue>::restoreDependencies(const std::vector<Dependency>& edges) {
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> linked; // (prerequisite, task) slots
+    linked.reserve(edges.size());
+    for (const Dependency& e : edges) {
+        auto t = slotOf_.find(e.task);
+        auto p = slotOf_.find(e.prerequisite);
+        if (t != slotOf_.end() && p != slotOf_.end()) linked.emplace_back(p->second, t->second);
+    }
+    if (linked.empty()) return;
+    growLinks();
+
+    // dependents by slot, in one array
+    std::vector<std::uint32_t> first(ids_.size() + 1, 0), indegree(ids_.size(), 0);
+    for (const auto& [p, t] : linked) {
+        ++first[p + 1];
+        ++indegree[t];
+    }
+    for (std::size_t slot = 0; slot < ids_.size(); ++slot) first[slot + 1] += first[slot];
+    std::vector<std::uint32_t> next(first.begin(), first.end() - 1), dependents(linked.size());
+    for (const auto& [p, t] : linked) dependents[next[p]++] = t;
+    std::vector<std::uint32_t> ready;
+    for (std::uint32_t slot = 0; slot < ids_.size(); ++slot) {
+        if (indegree[slot] == 0 && first[slot + 1] > first[slot]) ready.push_back(slot);
+    }
+    while (!ready.empty()) {
+        const std::uint32_t slot = ready.back();
+        ready.pop_back();
+        links_[slot].order = nextOrder_++;
+        for (std::uint32_t i = first[slot]; i < first[slot + 1]; ++i) {
+            if (--indegree[dependents[i]] == 0) ready.push_back(dependents[i]);
+        }
+    }
+    for (const auto& [p, t] : linked) linkTasks(t, p);
+}
+
+template bool BasicToDoList<HeapQueue>::addDependency(TaskId, TaskId);
+template std::size_t BasicToDoList<HeapQueue>::addDependencies(const std::vector<Dependency>&);
+template std::vector<TaskId> BasicToDoList<HeapQueue>::prerequisites(TaskId) const;
+template auto BasicToDoList<HeapQueue>::linkTasks(std::uint32_t, std::uint32_t) -> LinkResult;
+template void BasicToDoList<HeapQueue>::releaseDependents(std::uint32_t);
+template void BasicToDoList<HeapQueue>::restoreDependencies(const std::vector<Dependency>&);
+template bool BasicToDoList<PriorityBuckets>::addDependency(TaskId, TaskId);
+template std::size_t BasicToDoList<PriorityBuckets>::addDependencies(const std::vector<Dependency>&);
+template std::vector<TaskId> BasicToDoList<PriorityBuckets>::prerequisites(TaskId) const;
+template auto BasicToDoList<PriorityBuckets>::linkTasks(std::uint32_t, std::uint32_t) -> LinkResult;
+template void BasicToDoList<PriorityBuckets>::releaseDependents(std::uint32_t);
+template void BasicToDoList<PriorityBuckets>::restoreDependencies(const std::vector<Dependency>&);
+
+} // namespace smarttodo
@@ -0,0 +1,241 @@
+#include "../include/todo.h"
+#include "datetime.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <thread>
+
+namespace smarttodo {
+
+// Export layouts. The text formats list tasks in the queue's storage order (heap order,
+// or priority order on buckets; tasks waiting on prerequisites last), the columnar one
+// in slot order (tasks are identified by the id column).
+//   CSV:     a header line, then  priority,"added","due","description"  per task, with
+//            quotes in descriptions doubled (the format exportToCSV always wrote).
+//   NDJSON:  one object per line:
+//            {"id":1,"priority":2,"added":"2024-05-01 09:00","due":null,"description":"..."}
+//   Columnar (native byte order), for loading whole columns into analytics tools:
+//            magic "STDOCOL1" | u64 count | u64 id[count] | i32 priority[count] |
+//            i64 created[count] | i64 due[count] (INT64_MAX: none) |
+//            u64 descEnd[count] (end of each description in the blob) | blob
+namespace {
+
+const char kColumnarMagic[8] = {'S', 'T', 'D', 'O', 'C', 'O', 'L', '1'};
+// Tasks per chunk: enough that handing a chunk to a thread is noise, small enough that
+// the chunks in flight stay a few megabytes.
+const std::size_t kChunkTasks = 32 * 1024;
+const std::size_t kFlushBytes = 1 << 20;
+
+// Writes into a std::string through a raw cursor. Rows are a dozen short pieces, and a
+// std::string::append call per piece cost more than the formatting itself. need(n)
+// makes room for the next n bytes and done() ends a piece of output; the string is
+// trimmed to what was written by finish().
+class Appender {
+public:
+    explicit Appender(std::string& out) : out_(out), used_(out.size()) {}
+
+    void need(std::size_t n) {
+        if (out_.size() - used_ < n) out_.resize(std::max(2 * out_.size(), used_ + n));
+        p_ = &out_[used_];
+    }
+    void done() { used_ = static_cast<std::size_t>(p_ - out_.data()); }
+    void finish() { out_.resize(used_); }
+    std::string_view text() const { return std::string_view(out_.data(), used_); }
+    void clear() { used_ = 0; }
+
+    void put(char c) { *p_++ = c; }
+    void put(const char* text, std::size_t n) {
+        std::memcpy(p_, text, n);
+        p_ += n;
+    }
+    template <std::size_t N>
+    void put(const char (&literal)[N]) { put(literal, N - 1); }
+    template <typename T>
+    void putNumber(T value) { p_ = std::to_chars(p_, p_ + 24, value).ptr; }
+    void putTime(std::time_t time) { p_ += formatDateTime(time, p_); }
+    template <typename T>
+    void putRaw(T value) { put(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+    // Quotes doubled, copied in runs between them.
+    void putCsvEscaped(std::string_view text) {
+        for (;;) {
+            std::size_t quote = text.find('"');
+            if (quote == std::string_view::npos) break;
+            put(text.data(), quote + 1);
+            put('"');
+            text.remove_prefix(quote + 1);
+        }
+        put(text.data(), text.size());
+    }
+
+    void putJsonEscaped(std::string_view text) {
+        static const char hex[] = "0123456789abcdef";
+        std::size_t run = 0;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            put(text.data() + run, i - run);
+            run = i + 1;
+            put('\\');
+            switch (c) {
+                case '"': put('"'); break;
+                case '\\': put('\\'); break;
+                case '\n': put('n'); break;
+                case '\r': put('r'); break;
+                case '\t': put('t'); break;
+                default:
+                    put("u00");
+                    put(hex[c >> 4]);
+                    put(hex[c & 0xF]);
+            }
+        }
+        put(text.data() + run, text.size() - run);
+    }
+
+private:
+    std::string& out_;
+    std::size_t used_;
+    char* p_ = nullptr;
+};
+
+bool writeAll(std::ostream& file, std::string_view text) {
+    return static_cast<bool>(file.write(text.data(), static_cast<std::streamsize>(text.size())));
+}
+
+} // namespace
+
+template <typename Queue>
+bool BasicToDoList<Queue>::exportTasks(const std::string& filename, ExportFormat format, unsigned threads) const {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    if (format == ExportFormat::Columnar) return writeColumns(file) && file.flush();
+
+    if (format == ExportFormat::Csv) file << "Priority,Added,Due Date,Description\n";
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    // the queue is walked once up front so chunks can be cut anywhere in its order
+    std::vector<std::uint32_t> order;
+    order.reserve(size());
+    forEachTask([&order](std::uint32_t slot, int) { order.push_back(slot); });
+    const std::size_t chunks = (order.size() + kChunkTasks - 1) / kChunkTasks;
+    // chunks are formatted up to `window` ahead of the one being written; buffers are
+    // recycled so a long export allocates only for the first window
+    const std::size_t window = 2 * static_cast<std::size_t>(threads);
+    const auto policy = threads > 1 ? std::launch::async : std::launch::deferred;
+    std::deque<std::future<std::string>> pending;
+    std::vector<std::string> spare;
+    bool ok = true;
+    auto writeOldest = [&] {
+        std::string text = pending.front().get();
+        pending.pop_front();
+        ok = ok && writeAll(file, text);
+        spare.push_back(std::move(text));
+    };
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        if (pending.size() >= window) writeOldest();
+        std::string buffer;
+        if (!spare.empty()) {
+            buffer = std::move(spare.back());
+            spare.pop_back();
+        }
+        const std::uint32_t* begin = order.data() + chunk * kChunkTasks;
+        const std::uint32_t* end = order.data() + std::min(order.size(), (chunk + 1) * kChunkTasks);
+        pending.push_back(std::async(policy, [this, format, begin, end, buffer = std::move(buffer)]() mutable {
+            buffer.clear();
+            formatRows(format, begin, end, buffer);
+            return std::move(buffer);
+        }));
+    }
+    while (!pending.empty()) writeOldest();
+    return ok && file.flush();
+}
+
+// Formats the tasks in the slots [begin, end).
+template <typename Queue>
+void BasicToDoList<Queue>::formatRows(ExportFormat format, const std::uint32_t* begin, const std::uint32_t* end,
+                                      std::string& out) const {
+    Appender row(out);
+    for (const std::uint32_t* slot = begin; slot != end; ++slot) {
+        TaskView t = view(*slot);
+        // fixed fields fit in 128 bytes; escaping grows a description at most sixfold
+        row.need(128 + 6 * t.description.size());
+        if (format == ExportFormat::Csv) {
+            row.putNumber(t.priority);
+            row.put(",\"");
+            row.putTime(t.created);
+            row.put("\",\"");
+            row.putTime(t.dueTime);
+            row.put("\",\"");
+            row.putCsvEscaped(t.description);
+            row.put("\"\n");
+        } else {
+            row.put("{\"id\":");
+            row.putNumber(t.id);
+            row.put(",\"priority\":");
+            row.putNumber(t.priority);
+            row.put(",\"added\":\"");
+            row.putTime(t.created);
+            if (t.dueTime == kNoTime) {
+                row.put("\",\"due\":null");
+            } else {
+                row.put("\",\"due\":\"");
+                row.putTime(t.dueTime);
+                row.put('"');
+            }
+            row.put(",\"description\":\"");
+            row.putJsonEscaped(t.description);
+            row.put("\"}\n");
+        }
+        row.done();
+    }
+    row.finish();
+}
+
+// Column by column through one buffer, in slot order so every column is read
+// sequentially (queue order would make each a random walk over the slots). Each column
+// is a plain copy of a field, so there is nothing worth spreading over threads.
+template <typename Queue>
+bool BasicToDoList<Queue>::writeColumns(std::ostream& file) const {
+    std::string buffer;
+    Appender out(buffer);
+    out.need(sizeof(kColumnarMagic) + sizeof(std::uint64_t));
+    out.put(kColumnarMagic, sizeof(kColumnarMagic));
+    out.putRaw(static_cast<std::uint64_t>(size()));
+    out.done();
+    bool ok = true;
+    auto column = [&](auto field) {
+        for (std::uint32_t slot = 0; ok && slot < ids_.size(); ++slot) {
+            if (!descs_[slot]) continue; // free slot
+            field(slot);
+            out.done();
+            if (out.text().size() >= kFlushBytes) {
+                ok = writeAll(file, out.text());
+                out.clear();
+            }
+        }
+    };
+    column([&](std::uint32_t s) { out.need(8); out.putRaw(static_cast<std::uint64_t>(ids_[s])); });
+    column([&](std::uint32_t s) { out.need(4); out.putRaw(static_cast<std::int32_t>(priorityOf(s))); });
+    column([&](std::uint32_t s) { out.need(8); out.putRaw(static_cast<std::int64_t>(created_[s])); });
+    column([&](std::uint32_t s) { out.need(8); out.putRaw(static_cast<std::int64_t>(due_[s])); });
+    std::uint64_t descEnd = 0;
+    column([&](std::uint32_t s) {
+        out.need(8);
+        out.putRaw(descEnd += StringArena::view(descs_[s]).size());
+    });
+    column([&](std::uint32_t s) {
+        std::string_view desc = StringArena::view(descs_[s]);
+        out.need(desc.size());
+        out.put(desc.data(), desc.size());
+    });
+    return ok && writeAll(file, out.text());
+}
+
+template bool BasicToDoList<HeapQueue>::exportTasks(const std::string&, ExportFormat, unsigned) const;
+template bool BasicToDoList<PriorityBuckets>::exportTasks(const std::string&, ExportFormat, unsigned) const;
+
+} // namespace smarttodo
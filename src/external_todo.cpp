@@ -0,0 +1,627 @@
+#include "../include/external_todo.h"
+#include "../include/metrics.h"
+#include "datetime.h"
+#include "fs_util.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <set>
+
+namespace smarttodo {
+
+// A run file holds its tasks back to back in priority order, each a RunRecord followed
+// by the description. The manifest, "runs.manifest" (native byte order):
+//   magic "STDOEXT1" | u64 next ID | u64 next run number | u64 run count |
+//   run count x (u64 run number | u64 cursor offset | u64 tasks from the cursor on)
+// It is rewritten before any run file is deleted, so it never names a missing run.
+namespace {
+
+const char kManifestMagic[8] = {'S', 'T', 'D', 'O', 'E', 'X', 'T', '1'};
+const char* const kManifestName = "runs.manifest";
+const std::size_t kMinBlockBytes = 4096;
+// Streamed output (files and displayTasks()) is handed on in pieces of about this size.
+const std::size_t kChunkBytes = 256 * 1024;
+const int kDueSoonHours = 24;
+
+struct RunRecord {
+    std::int32_t priority;
+    std::uint32_t length;
+    std::int64_t created;
+    std::int64_t dueTime;
+    std::uint64_t id;
+};
+
+struct ManifestRun {
+    std::uint64_t number;
+    std::uint64_t offset;
+    std::uint64_t remaining;
+};
+
+static_assert(sizeof(RunRecord) == 32, "run record layout changed");
+static_assert(sizeof(ManifestRun) == 24, "manifest layout changed");
+
+using File = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+
+// Priority, then ID: the order runs are sorted in and tasks leave the list.
+template <typename Task>
+bool before(const Task& a, const Task& b) {
+    return a.priority != b.priority ? a.priority < b.priority : a.id < b.id;
+}
+
+// For the std heap functions, which keep the greatest element on top.
+struct Later {
+    template <typename Task>
+    bool operator()(const Task& a, const Task& b) const { return before(b, a); }
+};
+
+bool writeRecord(std::FILE* file, const TaskView& t) {
+    RunRecord r{t.priority, static_cast<std::uint32_t>(t.description.size()), t.created, t.dueTime, t.id};
+    return std::fwrite(&r, sizeof(r), 1, file) == 1 &&
+           std::fwrite(t.description.data(), 1, t.description.size(), file) == t.description.size();
+}
+
+// Closes `file` after syncing it; false if anything written to it failed.
+bool closeSynced(File& file, bool ok) {
+    if (!file) return false;
+    ok = syncFile(file.get()) && ok;
+    return std::fclose(file.release()) == 0 && ok;
+}
+
+// Writes `path` through a temporary file, renamed over it once complete and synced.
+class FileWriter {
+public:
+    explicit FileWriter(const std::string& path)
+        : path_(path), tmp_(path + ".tmp"), file_(std::fopen(tmp_.c_str(), "wb"), std::fclose) {}
+
+    std::string& text() { return text_; }
+    // Hands the text on once a chunk of it is ready.
+    void wrote() {
+        if (text_.size() >= kChunkBytes) write();
+    }
+    bool finish() {
+        write();
+        if (closeSynced(file_, ok_) && replaceFile(tmp_, path_)) return true;
+        std::remove(tmp_.c_str());
+        return false;
+    }
+
+private:
+    void write() {
+        ok_ = ok_ && file_ && std::fwrite(text_.data(), 1, text_.size(), file_.get()) == text_.size();
+        text_.clear();
+    }
+
+    std::string path_, tmp_;
+    File file_;
+    std::string text_;
+    bool ok_ = true;
+};
+
+void appendTime(std::string& text, std::time_t time) {
+    char stamp[kDateTimeLength];
+    text.append(stamp, formatDateTime(time, stamp));
+}
+
+// Accepts what std::stoi did: leading whitespace, an optional sign, trailing junk (a
+// recurring task's "@1w" among it).
+bool parsePriority(std::string_view text, int& value) {
+    std::size_t i = 0;
+    while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+    if (i < text.size() && text[i] == '+') ++i;
+    return std::from_chars(text.data() + i, text.data() + text.size(), value).ec == std::errc();
+}
+
+// A "priority|added|due|description" line, as ToDoList::saveToFile() writes them.
+bool parseTaskLine(std::string_view line, int& priority, std::time_t& created, std::time_t& dueTime,
+                   std::string_view& desc) {
+    const std::size_t a = line.find('|');
+    const std::size_t b = a == std::string_view::npos ? a : line.find('|', a + 1);
+    const std::size_t c = b == std::string_view::npos ? b : line.find('|', b + 1);
+    if (c == std::string_view::npos || !parsePriority(line.substr(0, a), priority)) return false;
+    created = parseDateTime(line.substr(a + 1, b - a - 1));
+    dueTime = parseDateTime(line.substr(b + 1, c - b - 1));
+    desc = line.substr(c + 1);
+    return true;
+}
+
+} // namespace
+
+// Reads a run from a given offset through a buffer of its own.
+class ExternalToDoList::Cursor {
+public:
+    bool open(const std::string& path, std::uint64_t offset, std::size_t bufferBytes) {
+        buffer_.resize(bufferBytes);
+        file_.reset(std::fopen(path.c_str(), "rb"));
+        next_ = offset;
+        return file_ && std::setvbuf(file_.get(), buffer_.data(), _IOFBF, buffer_.size()) == 0 &&
+               std::fseek(file_.get(), static_cast<long>(offset), SEEK_SET) == 0;
+    }
+    // Reads the next task; false at the end of the file or if it is cut short.
+    bool next() {
+        RunRecord r;
+        if (std::fread(&r, sizeof(r), 1, file_.get()) != 1) return false;
+        desc_.resize(r.length);
+        if (std::fread(desc_.data(), 1, r.length, file_.get()) != r.length) return false;
+        at_ = next_;
+        next_ += sizeof(r) + r.length;
+        task_ = TaskView{r.id, r.priority, desc_, static_cast<std::time_t>(r.created),
+                         static_cast<std::time_t>(r.dueTime)};
+        return true;
+    }
+    // Valid until next().
+    const TaskView& task() const { return task_; }
+    // Where task() starts in the file.
+    std::uint64_t offset() const { return at_; }
+    std::size_t memoryUsage() const { return buffer_.capacity() + desc_.capacity(); }
+
+private:
+    File file_{nullptr, std::fclose};
+    std::vector<char> buffer_;
+    std::string desc_;
+    TaskView task_{};
+    std::uint64_t at_ = 0, next_ = 0;
+};
+
+ExternalToDoList::ExternalToDoList(std::string directory, ExternalListOptions options)
+    : directory_(std::move(directory)), options_(std::move(options)), out_(options_.out) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+}
+
+ExternalToDoList::~ExternalToDoList() {
+    if (!flush()) std::cerr << "Failed to save the task runs in " << directory_ << std::endl;
+}
+
+std::string ExternalToDoList::runPath(std::uint64_t number) const {
+    return (std::filesystem::path(directory_) / ("run-" + std::to_string(number) + ".dat")).string();
+}
+
+// A read buffer for every run, with room for one more than maxRuns before a merge and
+// one to write the merged run, takes a quarter of the budget; a streaming pass opens
+// as many again.
+std::size_t ExternalToDoList::blockSize() const {
+    return std::max(kMinBlockBytes, options_.memoryBudget / (4 * (options_.maxRuns + 2)));
+}
+
+TaskView ExternalToDoList::view(const Pending& p) const {
+    return TaskView{p.id, p.priority, std::string_view(buffer_.data() + p.offset, p.length), p.created, p.dueTime};
+}
+
+bool ExternalToDoList::bufferFirst() const {
+    if (heads_.empty()) return true;
+    if (pending_.empty()) return false;
+    return before(view(pending_.front()), runs_[heads_.front()].cursor->task());
+}
+
+TaskView ExternalToDoList::front() const {
+    return bufferFirst() ? view(pending_.front()) : runs_[heads_.front()].cursor->task();
+}
+
+TaskId ExternalToDoList::insertTask(int priority, const std::string& desc, const std::string& dueDate) {
+    SMARTTODO_TIME(Insert);
+    const std::time_t created = currentMinute();
+    const TaskId id = add(priority, desc, created, parseDateTime(dueDate));
+    if (id != kNoTaskId) *out_ << "Task added at " << formatDateTime(created) << " (ID " << id << ")" << std::endl;
+    return id;
+}
+
+// The buffer's two parts are sized once, from the budget, so they never grow past it
+// (a description larger than its whole part is the exception).
+TaskId ExternalToDoList::add(int priority, std::string_view desc, std::time_t created, std::time_t dueTime) {
+    if (pending_.capacity() == 0) {
+        pending_.reserve(std::max<std::size_t>(1, options_.memoryBudget / 4 / sizeof(Pending)));
+        buffer_.reserve(options_.memoryBudget / 4);
+    }
+    const bool full = pending_.size() == pending_.capacity() || buffer_.size() + desc.size() > buffer_.capacity();
+    if (full && !pending_.empty() && !spill()) return kNoTaskId;
+
+    const TaskId id = nextId_++;
+    pending_.push_back(Pending{priority, static_cast<std::uint32_t>(desc.size()), created, dueTime, id, buffer_.size()});
+    buffer_.append(desc.data(), desc.size());
+    std::push_heap(pending_.begin(), pending_.end(), Later());
+    ++size_;
+    return id;
+}
+
+void ExternalToDoList::removeTask() {
+    SMARTTODO_TIME(Remove);
+    if (size_ == 0) {
+        *out_ << "No tasks to remove!" << std::endl;
+        return;
+    }
+    const TaskView t = front();
+    *out_ << "Completed Task: " << t.description << " (Added: " << formatDateTime(t.created) << ")" << std::endl;
+    popFront();
+}
+
+void ExternalToDoList::peekTask() const {
+    if (size_ == 0) {
+        *out_ << "No tasks available!" << std::endl;
+        return;
+    }
+    const TaskView t = front();
+    *out_ << "Next Task: " << t.description << " (Priority " << t.priority << ", Added: "
+          << formatDateTime(t.created) << ", Due: " << (t.dueTime == kNoTime ? "None" : formatDateTime(t.dueTime))
+          << ")" << std::endl;
+}
+
+void ExternalToDoList::popFront() {
+    --size_;
+    if (bufferFirst()) {
+        std::pop_heap(pending_.begin(), pending_.end(), Later());
+        pending_.pop_back();
+        if (pending_.empty()) buffer_.clear(); // descriptions of popped tasks stay until then
+        return;
+    }
+    auto later = [this](std::uint32_t a, std::uint32_t b) {
+        return before(runs_[b].cursor->task(), runs_[a].cursor->task());
+    };
+    std::pop_heap(heads_.begin(), heads_.end(), later);
+    Run& run = runs_[heads_.back()];
+    if (--run.remaining && run.cursor->next()) {
+        std::push_heap(heads_.begin(), heads_.end(), later);
+        return;
+    }
+    if (run.remaining) {
+        std::cerr << "Failed to read " << runPath(run.number) << "; " << run.remaining << " tasks lost" << std::endl;
+        size_ -= run.remaining;
+    }
+    const std::uint64_t number = run.number;
+    runs_.erase(runs_.begin() + heads_.back());
+    rebuildHeads();
+    retire({number});
+}
+
+void ExternalToDoList::rebuildHeads() {
+    heads_.resize(runs_.size());
+    std::iota(heads_.begin(), heads_.end(), 0u);
+    std::make_heap(heads_.begin(), heads_.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return before(runs_[b].cursor->task(), runs_[a].cursor->task());
+    });
+}
+
+bool ExternalToDoList::spill() {
+    if (pending_.empty()) return true;
+    std::sort(pending_.begin(), pending_.end(), [](const Pending& a, const Pending& b) { return before(a, b); });
+    const std::uint64_t number = nextRun_++;
+    const std::string path = runPath(number);
+    std::vector<char> block(blockSize());
+    File file(std::fopen(path.c_str(), "wb"), std::fclose);
+    bool ok = file && std::setvbuf(file.get(), block.data(), _IOFBF, block.size()) == 0;
+    for (std::size_t i = 0; ok && i < pending_.size(); ++i) ok = writeRecord(file.get(), view(pending_[i]));
+    Run run{number, pending_.size(), std::make_unique<Cursor>()};
+    if (!closeSynced(file, ok) || !run.cursor->open(path, 0, blockSize()) || !run.cursor->next()) {
+        std::remove(path.c_str());
+        std::cerr << "Failed to write " << path << std::endl;
+        std::make_heap(pending_.begin(), pending_.end(), Later());
+        return false;
+    }
+    runs_.push_back(std::move(run));
+    pending_.clear();
+    buffer_.clear();
+    // a failed merge leaves the runs as they were, so the spill itself still stands
+    if (runs_.size() > options_.maxRuns) mergeSmallest();
+    rebuildHeads();
+    return true;
+}
+
+// Merges the runs with the fewest tasks left, one more than half of them, into one run
+// holding just their remaining tasks.
+bool ExternalToDoList::mergeSmallest() {
+    std::sort(runs_.begin(), runs_.end(), [](const Run& a, const Run& b) { return a.remaining < b.remaining; });
+    const std::size_t count = runs_.size() / 2 + 1;
+    std::vector<ManifestRun> start; // where the merged runs' cursors were, to go back on failure
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        start.push_back({runs_[i].number, runs_[i].cursor->offset(), runs_[i].remaining});
+        total += runs_[i].remaining;
+    }
+
+    const std::uint64_t number = nextRun_++;
+    const std::string path = runPath(number);
+    std::vector<char> block(blockSize());
+    File file(std::fopen(path.c_str(), "wb"), std::fclose);
+    bool ok = file && std::setvbuf(file.get(), block.data(), _IOFBF, block.size()) == 0;
+    std::vector<std::uint32_t> heads(count);
+    std::iota(heads.begin(), heads.end(), 0u);
+    auto later = [this](std::uint32_t a, std::uint32_t b) {
+        return before(runs_[b].cursor->task(), runs_[a].cursor->task());
+    };
+    std::make_heap(heads.begin(), heads.end(), later);
+    while (ok && !heads.empty()) {
+        std::pop_heap(heads.begin(), heads.end(), later);
+        Run& run = runs_[heads.back()];
+        ok = writeRecord(file.get(), run.cursor->task());
+        if (--run.remaining == 0) heads.pop_back();
+        else if ((ok = ok && run.cursor->next())) std::push_heap(heads.begin(), heads.end(), later);
+    }
+    Run merged{number, total, std::make_unique<Cursor>()};
+    if (!closeSynced(file, ok) || !merged.cursor->open(path, 0, blockSize()) || !merged.cursor->next()) {
+        std::remove(path.c_str());
+        std::cerr << "Failed to merge runs into " << path << std::endl;
+        for (std::size_t i = 0; i < count; ++i) {
+            runs_[i].remaining = start[i].remaining;
+            runs_[i].cursor->open(runPath(start[i].number), start[i].offset, blockSize());
+            runs_[i].cursor->next();
+        }
+        return false;
+    }
+    runs_.erase(runs_.begin(), runs_.begin() + static_cast<std::ptrdiff_t>(count));
+    runs_.push_back(std::move(merged));
+    rebuildHeads();
+    std::vector<std::uint64_t> done;
+    for (const ManifestRun& r : start) done.push_back(r.number);
+    retire(done);
+    return true;
+}
+
+// Deletes the files of runs no longer in the list once the manifest stops naming them.
+// If it cannot be written they stay, and open() deletes them after the next flush().
+void ExternalToDoList::retire(const std::vector<std::uint64_t>& numbers) {
+    if (!writeManifest()) return;
+    for (std::uint64_t number : numbers) std::remove(runPath(number).c_str());
+}
+
+bool ExternalToDoList::writeManifest() const {
+    std::string image(kManifestMagic, sizeof(kManifestMagic));
+    const std::uint64_t header[3] = {nextId_, nextRun_, runs_.size()};
+    image.append(reinterpret_cast<const char*>(header), sizeof(header));
+    for (const Run& run : runs_) {
+        ManifestRun r{run.number, run.cursor->offset(), run.remaining};
+        image.append(reinterpret_cast<const char*>(&r), sizeof(r));
+    }
+    FileWriter writer((std::filesystem::path(directory_) / kManifestName).string());
+    writer.text() = std::move(image);
+    return writer.finish();
+}
+
+bool ExternalToDoList::flush() {
+    return spill() && writeManifest();
+}
+
+void ExternalToDoList::clear() {
+    std::vector<std::uint64_t> numbers;
+    for (const Run& run : runs_) numbers.push_back(run.number);
+    forget();
+    if (!numbers.empty()) retire(numbers);
+}
+
+void ExternalToDoList::forget() {
+    runs_.clear();
+    heads_.clear();
+    pending_.clear();
+    buffer_.clear();
+    size_ = 0;
+}
+
+bool ExternalToDoList::open() {
+    // what the list holds is flushed, so the manifest read back below names it
+    if ((!runs_.empty() || !pending_.empty()) && !flush()) return false;
+    forget();
+    const std::filesystem::path manifestPath = std::filesystem::path(directory_) / kManifestName;
+    std::ifstream file(manifestPath, std::ios::binary);
+    std::string image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::set<std::uint64_t> named;
+    if (file.is_open()) {
+        std::uint64_t header[3];
+        if (image.size() < sizeof(kManifestMagic) + sizeof(header) ||
+            std::memcmp(image.data(), kManifestMagic, sizeof(kManifestMagic)) != 0) {
+            return false;
+        }
+        std::memcpy(header, image.data() + sizeof(kManifestMagic), sizeof(header));
+        const std::size_t first = sizeof(kManifestMagic) + sizeof(header);
+        if (header[2] != (image.size() - first) / sizeof(ManifestRun) ||
+            (image.size() - first) % sizeof(ManifestRun) != 0) {
+            return false;
+        }
+        for (std::uint64_t i = 0; i < header[2]; ++i) {
+            ManifestRun r;
+            std::memcpy(&r, image.data() + first + i * sizeof(r), sizeof(r));
+            Run run{r.number, r.remaining, std::make_unique<Cursor>()};
+            if (r.remaining == 0 || !run.cursor->open(runPath(r.number), r.offset, blockSize()) ||
+                !run.cursor->next()) {
+                forget();
+                return false;
+            }
+            named.insert(r.number);
+            size_ += r.remaining;
+            runs_.push_back(std::move(run));
+        }
+        nextId_ = std::max<TaskId>(nextId_, header[0]);
+        nextRun_ = std::max(nextRun_, header[1]);
+    }
+    rebuildHeads();
+
+    // runs spilled or merged after the last manifest was written, and an unfinished
+    // manifest; other files, such as the temporary ones of a save into the directory,
+    // are left alone
+    const std::string manifestTemp = std::string(kManifestName) + ".tmp";
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, ec)) {
+        const std::string name = entry.path().filename().string();
+        std::uint64_t number = 0;
+        const bool isRun = name.size() > 8 && name.compare(0, 4, "run-") == 0 &&
+                           name.compare(name.size() - 4, 4, ".dat") == 0 &&
+                           std::from_chars(name.data() + 4, name.data() + name.size() - 4, number).ptr ==
+                               name.data() + name.size() - 4;
+        if ((isRun && !named.count(number)) || name == manifestTemp) std::filesystem::remove(entry.path(), ec);
+    }
+    return true;
+}
+
+template <typename Visit>
+bool ExternalToDoList::forEachInOrder(Visit visit) const {
+    std::vector<std::unique_ptr<Cursor>> cursors;
+    std::vector<std::uint64_t> left;
+    for (const Run& run : runs_) {
+        cursors.push_back(std::make_unique<Cursor>());
+        left.push_back(run.remaining);
+        if (!cursors.back()->open(runPath(run.number), run.cursor->offset(), blockSize()) ||
+            !cursors.back()->next()) {
+            return false;
+        }
+    }
+    std::vector<std::uint32_t> buffered(pending_.size());
+    std::iota(buffered.begin(), buffered.end(), 0u);
+    std::sort(buffered.begin(), buffered.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return before(pending_[a], pending_[b]);
+    });
+
+    std::vector<std::uint32_t> heads(cursors.size());
+    std::iota(heads.begin(), heads.end(), 0u);
+    auto later = [&](std::uint32_t a, std::uint32_t b) { return before(cursors[b]->task(), cursors[a]->task()); };
+    std::make_heap(heads.begin(), heads.end(), later);
+    std::size_t next = 0;
+    while (!heads.empty() || next < buffered.size()) {
+        if (next < buffered.size() &&
+            (heads.empty() || before(view(pending_[buffered[next]]), cursors[heads.front()]->task()))) {
+            if (!visit(view(pending_[buffered[next++]]))) return true;
+            continue;
+        }
+        if (!visit(cursors[heads.front()]->task())) return true;
+        std::pop_heap(heads.begin(), heads.end(), later);
+        const std::uint32_t i = heads.back();
+        if (--left[i] == 0) heads.pop_back();
+        else if (cursors[i]->next()) std::push_heap(heads.begin(), heads.end(), later);
+        else return false;
+    }
+    return true;
+}
+
+void ExternalToDoList::displayTasks(std::size_t offset, std::size_t limit) const {
+    SMARTTODO_TIME(Display);
+    if (size_ == 0) {
+        *out_ << "No tasks available!" << std::endl;
+        return;
+    }
+
+    std::string text = "\nYour To-Do List (Heap View):\n";
+    const std::string rule = "---------------------------------------------------------------\n";
+    text += rule;
+    const std::time_t now = std::time(nullptr);
+    std::size_t index = 0, shown = 0;
+    const bool ok = forEachInOrder([&](const TaskView& task) {
+        if (index++ < offset) return true;
+        if (shown == limit) return false;
+        text += "ID: ";
+        text += std::to_string(task.id);
+        text += " | Priority: ";
+        text += std::to_string(task.priority);
+        text += " | Added: ";
+        appendTime(text, task.created);
+        text += " | Due: ";
+        if (task.dueTime == kNoTime) text += "None";
+        else appendTime(text, task.dueTime);
+        if (task.dueTime != kNoTime && task.dueTime < now) text += " (OVERDUE)";
+        else if (task.dueTime != kNoTime && task.dueTime > now && task.dueTime - now <= kDueSoonHours * 3600) {
+            text += " (Due Soon)";
+        }
+        text += " | Task: ";
+        text.append(task.description.data(), task.description.size());
+        text += '\n';
+        if (text.size() >= kChunkBytes) {
+            *out_ << text;
+            text.clear();
+        }
+        ++shown;
+        return true;
+    });
+    if (!ok) std::cerr << "Failed to read the task runs in " << directory_ << std::endl;
+    text += rule;
+    if (shown < size_) {
+        text += shown ? "Showing " + std::to_string(offset + 1) + "-" + std::to_string(offset + shown)
+                      : std::string("Showing none");
+        text += " of " + std::to_string(size_) + " tasks\n";
+    }
+    *out_ << text << std::flush;
+}
+
+bool ExternalToDoList::saveToFile(const std::string& filename) const {
+    SMARTTODO_TIME(Save);
+    FileWriter writer(filename);
+    std::string& text = writer.text();
+    const bool ok = forEachInOrder([&](const TaskView& t) {
+        text += std::to_string(t.priority);
+        text += '|';
+        appendTime(text, t.created);
+        text += '|';
+        appendTime(text, t.dueTime);
+        text += '|';
+        text.append(t.description.data(), t.description.size());
+        text += '\n';
+        writer.wrote();
+        return true;
+    });
+    return writer.finish() && ok;
+}
+
+LoadStats ExternalToDoList::loadFromFile(const std::string& filename) {
+    SMARTTODO_TIME(Load);
+    LoadStats stats;
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) return stats;
+    clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue; // blank lines are skipped without counting as malformed
+        int priority;
+        std::time_t created, dueTime;
+        std::string_view desc;
+        if (!parseTaskLine(line, priority, created, dueTime, desc)) {
+            ++stats.rejected;
+            continue;
+        }
+        if (add(priority, desc, created, dueTime) == kNoTaskId) {
+            // a run could not be written: this line and the rest go unloaded
+            std::size_t unstored = 1;
+            while (std::getline(file, line)) unstored += !line.empty();
+            stats.rejected += unstored;
+            *out_ << "Loaded " << stats.loaded << " tasks of " << filename << "; " << unstored
+                  << " more could not be stored" << std::endl;
+            break;
+        }
+        ++stats.loaded;
+    }
+    return stats;
+}
+
+void ExternalToDoList::exportToCSV(const std::string& filename) const {
+    FileWriter writer(filename);
+    std::string& text = writer.text();
+    text = "Priority,Added,Due Date,Description\n";
+    const bool ok = forEachInOrder([&](const TaskView& t) {
+        text += std::to_string(t.priority);
+        text += ",\"";
+        appendTime(text, t.created);
+        text += "\",\"";
+        appendTime(text, t.dueTime);
+        text += "\",\"";
+        for (char c : t.description) {
+            if (c == '"') text += '"';
+            text += c;
+        }
+        text += "\"\n";
+        writer.wrote();
+        return true;
+    });
+    if (!writer.finish() || !ok) {
+        std::cerr << "Failed to write CSV" << std::endl;
+        return;
+    }
+    *out_ << "Tasks exported to " << filename << std::endl;
+}
+
+std::size_t ExternalToDoList::memoryUsage() const {
+    std::size_t bytes = pending_.capacity() * sizeof(Pending) + buffer_.capacity() +
+                        heads_.capacity() * sizeof(std::uint32_t) + runs_.capacity() * sizeof(Run);
+    for (const Run& run : runs_) bytes += sizeof(Cursor) + run.cursor->memoryUsage();
+    return bytes;
+}
+
+} // namespace smarttodo
@@ -0,0 +1,37 @@
+#include "fs_util.h"
+
+#include <filesystem>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define SMARTTODO_HAVE_FSYNC 1
+#endif
+
+namespace smarttodo {
+
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) return false;
+#ifdef SMARTTODO_HAVE_FSYNC
+    return ::fsync(::fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+bool replaceFile(const std::string& from, const std::string& to) {
+    std::error_code ec;
+    std::filesystem::rename(from, to, ec);
+    if (ec) return false;
+#ifdef SMARTTODO_HAVE_FSYNC
+    std::filesystem::path parent = std::filesystem::path(to).parent_path();
+    int dirFd = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+#endif
+    return true;
+}
+
+} // namespace smarttodo
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdio>
+#include <string>
+
+namespace smarttodo {
+
+// Flushes stdio buffers and forces the file's contents to stable storage.
+bool syncFile(std::FILE* file);
+
+// Renames `from` over `to` and, where supported, syncs the parent directory so the
+// rename itself survives a crash.
+bool replaceFile(const std::string& from, const std::string& to);
+
+} // namespace smarttodo
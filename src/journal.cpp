@@ -0,0 +1,352 @@
+#include "../include/journal.h"
+#include "fs_util.h"
+#include "mapped_file.h"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace smarttodo {
+
+// Record framing: u32 payload length | u32 CRC-32 of payload | payload, where the payload
+// is u8 op | u64 lsn | u64 task id, then for updates i32 priority, for dependencies
+// u64 prerequisite id, and for inserts i32 priority | i64 created | i64 due time |
+// u32 description length | description, recurring inserts adding u32 recurrence.
+// Legacy inserts instead have i32 priority | i64 due time | u16 timestamp length |
+// u16 due date length | u32 description length | the three strings.
+namespace {
+
+const std::size_t kFrameHeader = 8;
+const std::size_t kRecordFixed = 1 + 8 + 8;
+const std::size_t kInsertFixed = kRecordFixed + 4 + 8 + 8 + 4;
+const std::size_t kLegacyInsertFixed = kRecordFixed + 4 + 8 + 2 + 2 + 4;
+
+std::uint32_t crc32(const char* data, std::size_t len) {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < len; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void put(std::string& out, T value) {
+    char buf[sizeof(T)];
+    std::memcpy(buf, &value, sizeof(T));
+    out.append(buf, sizeof(T));
+}
+
+template <typename T>
+T get(const char*& p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+}
+
+void encode(const JournalRecord& r, std::string& out) {
+    std::size_t frameStart = out.size();
+    out.append(kFrameHeader, '\0');
+    put<std::uint8_t>(out, static_cast<std::uint8_t>(r.op));
+    put<std::uint64_t>(out, r.lsn);
+    put<std::uint64_t>(out, r.id);
+    if (r.op == JournalRecord::Op::Update) put<std::int32_t>(out, r.priority);
+    if (r.op == JournalRecord::Op::Depend) put<std::uint64_t>(out, r.prerequisite);
+    if (r.op == JournalRecord::Op::Insert || r.op == JournalRecord::Op::RecurringInsert) {
+        put<std::int32_t>(out, r.priority);
+        put<std::int64_t>(out, static_cast<std::int64_t>(r.created));
+        put<std::int64_t>(out, static_cast<std::int64_t>(r.dueTime));
+        put<std::uint32_t>(out, static_cast<std::uint32_t>(r.description.size()));
+        out.append(r.description.data(), r.description.size());
+        if (r.op == JournalRecord::Op::RecurringInsert) put<std::uint32_t>(out, r.recurrence);
+    }
+    std::uint32_t len = static_cast<std::uint32_t>(out.size() - frameStart - kFrameHeader);
+    std::uint32_t crc = crc32(out.data() + frameStart + kFrameHeader, len);
+    std::memcpy(&out[frameStart], &len, 4);
+    std::memcpy(&out[frameStart + 4], &crc, 4);
+}
+
+bool decode(const char* p, std::size_t len, JournalRecord& r) {
+    if (len < kRecordFixed) return false;
+    const char* end = p + len;
+    r.op = static_cast<JournalRecord::Op>(get<std::uint8_t>(p));
+    r.lsn = get<std::uint64_t>(p);
+    r.id = get<std::uint64_t>(p);
+    if (r.op == JournalRecord::Op::Remove) return p == end;
+    if (r.op == JournalRecord::Op::Update) {
+        if (end - p != 4) return false;
+        r.priority = get<std::int32_t>(p);
+        return true;
+    }
+    if (r.op == JournalRecord::Op::Depend) {
+        if (end - p != 8) return false;
+        r.prerequisite = get<std::uint64_t>(p);
+        return true;
+    }
+    if (r.op == JournalRecord::Op::Insert || r.op == JournalRecord::Op::RecurringInsert) {
+        const std::size_t extra = r.op == JournalRecord::Op::RecurringInsert ? 4 : 0;
+        if (len < kInsertFixed + extra) return false;
+        r.priority = get<std::int32_t>(p);
+        r.created = static_cast<std::time_t>(get<std::int64_t>(p));
+        r.dueTime = static_cast<std::time_t>(get<std::int64_t>(p));
+        std::size_t descLen = get<std::uint32_t>(p);
+        if (static_cast<std::size_t>(end - p) != descLen + extra) return false;
+        r.description = std::string_view(p, descLen);
+        if (extra) {
+            p += descLen;
+            r.recurrence = get<std::uint32_t>(p);
+        }
+        return true;
+    }
+    if (r.op != JournalRecord::Op::LegacyInsert || len < kLegacyInsertFixed) return false;
+    r.priority = get<std::int32_t>(p);
+    r.dueTime = static_cast<std::time_t>(get<std::int64_t>(p));
+    std::size_t tsLen = get<std::uint16_t>(p);
+    std::size_t dueLen = get<std::uint16_t>(p);
+    std::size_t descLen = get<std::uint32_t>(p);
+    if (static_cast<std::size_t>(end - p) != tsLen + dueLen + descLen) return false;
+    r.timestamp = std::string_view(p, tsLen);
+    r.description = std::string_view(p + tsLen + dueLen, descLen);
+    return true;
+}
+
+// Replays one segment; returns the byte length of its intact prefix.
+std::size_t replaySegment(const std::string& path, std::uint64_t& lastLsn,
+                          const std::function<void(const JournalRecord&)>& apply) {
+    MappedFile file;
+    if (!file.open(path)) return 0;
+    const char* data = file.data();
+    std::size_t pos = 0;
+    JournalRecord r;
+    while (file.size() - pos >= kFrameHeader) {
+        std::uint32_t len, crc;
+        std::memcpy(&len, data + pos, 4);
+        std::memcpy(&crc, data + pos + 4, 4);
+        if (len > file.size() - pos - kFrameHeader) break;
+        const char* payload = data + pos + kFrameHeader;
+        if (crc32(payload, len) != crc || !decode(payload, len, r)) break;
+        apply(r);
+        if (r.lsn > lastLsn) lastLsn = r.lsn;
+        pos += kFrameHeader + len;
+    }
+    return pos;
+}
+
+std::string rotatedPath(const std::string& path) { return path + ".old"; }
+
+} // namespace
+
+Journal::Journal(std::string path, JournalOptions options)
+    : path_(std::move(path)), options_(options) {}
+
+Journal::~Journal() {
+    waitForCompaction();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (flusher_.joinable()) flusher_.join();
+    commit();
+    if (file_) std::fclose(file_);
+}
+
+std::uint64_t Journal::recover(const std::string& path,
+                               const std::function<void(const JournalRecord&)>& apply) {
+    std::uint64_t lastLsn = 0;
+    replaySegment(rotatedPath(path), lastLsn, apply);
+    std::size_t intact = replaySegment(path, lastLsn, apply);
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec) && std::filesystem::file_size(path, ec) > intact) {
+        std::filesystem::resize_file(path, intact, ec); // drop the torn tail
+    }
+    return lastLsn;
+}
+
+bool Journal::open(std::uint64_t nextLsn) {
+    std::lock_guard<std::mutex> io(ioMutex_);
+    file_ = std::fopen(path_.c_str(), "ab");
+    if (!file_) return false;
+    std::error_code ec;
+    logBytes_ = std::filesystem::file_size(path_, ec);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nextLsn_ = nextLsn;
+    }
+    flusher_ = std::thread(&Journal::flushLoop, this);
+    return true;
+}
+
+std::uint64_t Journal::append(JournalRecord& record) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        record.lsn = nextLsn_++;
+        std::size_t before = pending_.size();
+        encode(record, pending_);
+        logBytes_ += pending_.size() - before;
+        wake = pending_.size() >= options_.commitBytes;
+    }
+    if (wake) wake_.notify_one();
+    return record.lsn;
+}
+
+bool Journal::sync() { return commit(); }
+
+bool Journal::needsCompaction() const {
+    return !compacting_ && (logBytes_ >= options_.compactBytes || compactDue_.load(std::memory_order_relaxed));
+}
+
+bool Journal::commit() {
+    std::lock_guard<std::mutex> io(ioMutex_);
+    finishRotation(); // records after the cut must not land in the old segment
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writing_.swap(pending_);
+    }
+    if (writing_.empty()) return ok_;
+    if (!file_) file_ = std::fopen(path_.c_str(), "ab"); // a failed rotation may have left it closed
+    if (!file_) {
+        // keep the records, ahead of any appended since, for the next commit
+        std::lock_guard<std::mutex> lock(mutex_);
+        writing_.append(pending_);
+        pending_.swap(writing_);
+        writing_.clear();
+        return false;
+    }
+    bool ok = std::fwrite(writing_.data(), 1, writing_.size(), file_) == writing_.size() &&
+              syncFile(file_);
+    writing_.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ok_ = ok_ && ok;
+    return ok_;
+}
+
+void Journal::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        wake_.wait_for(lock, options_.commitInterval,
+                       [this] { return stop_ || pending_.size() >= options_.commitBytes; });
+        if (options_.compactInterval.count() > 0 && logBytes_ > 0 &&
+            std::chrono::steady_clock::now() - lastCompaction_ >= options_.compactInterval) {
+            compactDue_.store(true, std::memory_order_relaxed);
+        }
+        if (pending_.empty()) continue;
+        lock.unlock();
+        commit();
+        lock.lock();
+    }
+}
+
+// Caller holds ioMutex_. Completes the cut compactAsync() made: writes the records before
+// it, moves the current segment aside and starts an empty one. A segment left behind by
+// a failed compaction is kept and the current one appended to it. On failure the records
+// stay in the current segment, which is reopened for appending.
+bool Journal::finishRotation() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!rotationPending_) return true;
+        rotationPending_ = false;
+        writing_.swap(rotating_);
+    }
+    rotationOk_ = false;
+    if (!file_) {
+        writing_.clear();
+        file_ = std::fopen(path_.c_str(), "ab");
+        return false;
+    }
+    bool ok = std::fwrite(writing_.data(), 1, writing_.size(), file_) == writing_.size() &&
+              syncFile(file_);
+    writing_.clear();
+    std::fclose(file_);
+    file_ = nullptr;
+    if (!ok) {
+        file_ = std::fopen(path_.c_str(), "ab");
+        return false;
+    }
+
+    const std::string old = rotatedPath(path_);
+    std::error_code ec;
+    if (std::filesystem::exists(old, ec)) {
+        // streaming an empty rdbuf sets failbit, so an empty segment is not copied at all
+        const std::uintmax_t size = std::filesystem::file_size(path_, ec);
+        if (ec || size > 0) {
+            std::ifstream in(path_, std::ios::binary);
+            std::ofstream out(old, std::ios::binary | std::ios::app);
+            if (ec || !(out << in.rdbuf()) || !out.flush()) {
+                file_ = std::fopen(path_.c_str(), "ab");
+                return false;
+            }
+        }
+        std::filesystem::remove(path_, ec);
+    } else if (!replaceFile(path_, old)) {
+        file_ = std::fopen(path_.c_str(), "ab");
+        return false;
+    }
+    file_ = std::fopen(path_.c_str(), "wb");
+    rotationOk_ = file_ != nullptr;
+    return rotationOk_;
+}
+
+bool Journal::compactAsync(std::function<bool()> writeSnapshot) {
+    if (compacting_) return false;
+    waitForCompaction();
+    {
+        // only the cut happens here; whoever takes ioMutex_ next finishes the rotation
+        std::lock_guard<std::mutex> lock(mutex_);
+        rotating_.swap(pending_);
+        rotationPending_ = true;
+        logBytes_ = 0;
+        lastCompaction_ = std::chrono::steady_clock::now();
+        compactDue_ = false;
+    }
+    compacting_ = true;
+    compactor_ = std::thread([this, writeSnapshot = std::move(writeSnapshot)] {
+        bool rotated;
+        {
+            std::lock_guard<std::mutex> io(ioMutex_);
+            finishRotation();
+            rotated = rotationOk_;
+        }
+        if (rotated && writeSnapshot()) {
+            std::error_code ec;
+            std::filesystem::remove(rotatedPath(path_), ec);
+        }
+        compacting_ = false;
+    });
+    return true;
+}
+
+void Journal::waitForCompaction() {
+    if (compactor_.joinable()) compactor_.join();
+}
+
+bool Journal::reset(std::uint64_t nextLsn) {
+    waitForCompaction();
+    std::lock_guard<std::mutex> io(ioMutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.clear();
+        logBytes_ = 0;
+        lastCompaction_ = std::chrono::steady_clock::now();
+        compactDue_ = false;
+        if (nextLsn > nextLsn_) nextLsn_ = nextLsn;
+    }
+    if (file_) std::fclose(file_);
+    file_ = std::fopen(path_.c_str(), "wb");
+    std::error_code ec;
+    std::filesystem::remove(rotatedPath(path_), ec);
+    return file_ != nullptr && syncFile(file_);
+}
+
+} // namespace smarttodo
@@ -0,0 +1,224 @@
+#include "../include/list_manager.h"
+#include "fs_util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+namespace smarttodo {
+
+// Summary file layout (native byte order):
+//   magic "STDOSUM1" | u64 list size | u32 n | n x (u64 id | i32 priority | i64 due time |
+//   u32 description length | description)
+namespace {
+
+const char kSummaryMagic[8] = {'S', 'T', 'D', 'O', 'S', 'U', 'M', '1'};
+const char* const kSnapshotExt = ".db";
+const char* const kJournalExt = ".wal";
+const char* const kSummaryExt = ".sum";
+
+template <typename T>
+void putRaw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool getRaw(const std::string& in, std::size_t& pos, T& value) {
+    if (in.size() - pos < sizeof(value)) return false;
+    std::memcpy(&value, in.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+// urgent first: priority, then list name, then the list's own order (kept by stable sorts)
+bool moreUrgent(const ListTask& a, const ListTask& b) {
+    return a.priority != b.priority ? a.priority < b.priority : a.list < b.list;
+}
+
+} // namespace
+
+ListManager::ListManager(std::string directory, ListManagerOptions options)
+    : directory_(std::move(directory)), options_(std::move(options)) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+}
+
+ListManager::~ListManager() { flushAll(); }
+
+bool ListManager::validName(std::string_view name) {
+    if (name.empty() || name.size() > 64 || name.front() == '.') return false;
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ||
+               c == '-' || c == '.';
+    });
+}
+
+std::string ListManager::pathFor(const std::string& name, const char* extension) const {
+    return (std::filesystem::path(directory_) / (name + extension)).string();
+}
+
+ListManager::Handle ListManager::open(const std::string& name) {
+    auto found = byName_.find(name);
+    if (found != byName_.end()) {
+        resident_.splice(resident_.begin(), resident_, found->second);
+        return found->second->list;
+    }
+    if (!validName(name)) return nullptr;
+    auto list = std::make_shared<BucketToDoList>(*options_.out, options_.maxTasksPerList);
+    if (!list->openJournal(pathFor(name, kSnapshotExt), pathFor(name, kJournalExt), options_.journal)) {
+        return nullptr;
+    }
+    resident_.push_front(Resident{name, list});
+    byName_[name] = resident_.begin();
+    trim();
+    return list;
+}
+
+bool ListManager::evict(const std::string& name) {
+    auto found = byName_.find(name);
+    if (found == byName_.end() || found->second->list.use_count() > 1) return false;
+    flush(*found->second);
+    resident_.erase(found->second);
+    byName_.erase(found);
+    return true;
+}
+
+void ListManager::flushAll() {
+    for (auto& entry : resident_) flush(entry);
+}
+
+bool ListManager::flush(Resident& entry) {
+    bool ok = entry.list->checkpoint();
+    return writeSummary(entry.name, summarize(entry.name, *entry.list)) && ok;
+}
+
+std::size_t ListManager::residentBytes() const {
+    std::size_t bytes = 0;
+    for (const auto& entry : resident_) bytes += entry.list->memoryUsage();
+    return bytes;
+}
+
+void ListManager::trim() {
+    std::size_t bytes = residentBytes();
+    auto it = resident_.end();
+    while ((bytes > options_.memoryBudget || resident_.size() > options_.maxOpenLists) &&
+           it != std::next(resident_.begin())) {
+        --it;
+        if (it->list.use_count() > 1) continue; // pinned
+        bytes -= std::min(bytes, it->list->memoryUsage());
+        flush(*it);
+        byName_.erase(it->name);
+        it = resident_.erase(it);
+    }
+}
+
+std::vector<std::string> ListManager::names() const {
+    std::set<std::string> found;
+    std::error_code ec;
+    for (const auto& file : std::filesystem::directory_iterator(directory_, ec)) {
+        const std::filesystem::path& path = file.path();
+        const std::string ext = path.extension().string();
+        const std::string stem = path.stem().string();
+        if ((ext == kSnapshotExt || ext == kJournalExt) && validName(stem)) found.insert(stem);
+    }
+    for (const auto& entry : resident_) found.insert(entry.name);
+    return std::vector<std::string>(found.begin(), found.end());
+}
+
+ListManager::Summary ListManager::summarize(const std::string& name, const BucketToDoList& list) const {
+    Summary summary;
+    summary.size = list.size();
+    for (const TaskView& t : list.topK(kSummaryTasks)) {
+        std::string_view desc = t.description.substr(0, kSummaryDescription);
+        summary.top.push_back(ListTask{name, t.id, t.priority, t.dueTime, std::string(desc)});
+    }
+    return summary;
+}
+
+bool ListManager::writeSummary(const std::string& name, const Summary& summary) const {
+    std::string image(kSummaryMagic, sizeof(kSummaryMagic));
+    putRaw(image, static_cast<std::uint64_t>(summary.size));
+    putRaw(image, static_cast<std::uint32_t>(summary.top.size()));
+    for (const ListTask& t : summary.top) {
+        putRaw(image, static_cast<std::uint64_t>(t.id));
+        putRaw(image, static_cast<std::int32_t>(t.priority));
+        putRaw(image, static_cast<std::int64_t>(t.dueTime));
+        putRaw(image, static_cast<std::uint32_t>(t.description.size()));
+        image += t.description;
+    }
+    const std::string path = pathFor(name, kSummaryExt);
+    const std::string tmp = path + ".tmp";
+    std::FILE* file = std::fopen(tmp.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+    ok = std::fclose(file) == 0 && ok;
+    return ok && replaceFile(tmp, path);
+}
+
+bool ListManager::readSummary(const std::string& name, Summary& summary) const {
+    std::ifstream file(pathFor(name, kSummaryExt), std::ios::binary);
+    std::string image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (image.size() < sizeof(kSummaryMagic) ||
+        std::memcmp(image.data(), kSummaryMagic, sizeof(kSummaryMagic)) != 0) {
+        return false;
+    }
+    std::size_t pos = sizeof(kSummaryMagic);
+    std::uint64_t size;
+    std::uint32_t count;
+    if (!getRaw(image, pos, size) || !getRaw(image, pos, count) || count > kSummaryTasks) return false;
+    summary.size = static_cast<std::size_t>(size);
+    summary.top.clear();
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::uint64_t id;
+        std::int32_t priority;
+        std::int64_t due;
+        std::uint32_t len;
+        if (!getRaw(image, pos, id) || !getRaw(image, pos, priority) || !getRaw(image, pos, due) ||
+            !getRaw(image, pos, len) || len > kSummaryDescription || image.size() - pos < len) {
+            return false;
+        }
+        summary.top.push_back(ListTask{name, id, priority, static_cast<std::time_t>(due), image.substr(pos, len)});
+        pos += len;
+    }
+    return true;
+}
+
+template <typename Visit>
+void ListManager::forEachSummary(Visit visit) const {
+    Summary summary;
+    for (const std::string& name : names()) {
+        auto found = byName_.find(name);
+        if (found != byName_.end()) {
+            visit(summarize(name, *found->second->list));
+        } else if (readSummary(name, summary)) {
+            visit(summary);
+        }
+    }
+}
+
+std::vector<ListTask> ListManager::topUrgent(std::size_t k) const {
+    k = std::min(k, kSummaryTasks);
+    // names() is sorted, so appending each list's tasks in its own order and merging
+    // stably keeps ties by list name, then by rank in the list
+    std::vector<ListTask> best;
+    forEachSummary([&](const Summary& summary) {
+        std::size_t keep = best.size();
+        best.insert(best.end(), summary.top.begin(), summary.top.end());
+        std::inplace_merge(best.begin(), best.begin() + static_cast<std::ptrdiff_t>(keep), best.end(),
+                           moreUrgent);
+        if (best.size() > k) best.resize(k);
+    });
+    return best;
+}
+
+std::size_t ListManager::totalTasks() const {
+    std::size_t total = 0;
+    forEachSummary([&](const Summary& summary) { total += summary.size; });
+    return total;
+}
+
+} // namespace smarttodo
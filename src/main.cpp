@@ -1,21 +1,266 @@
+#include "../include/batch.h"
+#include "../include/list_manager.h"
+#include "../include/metrics.h"
+#include "../include/reminder_scheduler.h"
+#include "../include/task_server.h"
 #include "../include/todo.h"
+#include "datetime.h"
 
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
-int main() {
-    smarttodo::ToDoList toDoList;
-    const std::string dataFilename = "tasks.txt";
+// Prompts for a number; on bad input clears the stream and returns false.
+template <typename T>
+static bool promptNumber(const char* prompt, T& value) {
+    std::cout << prompt;
+    bool ok = static_cast<bool>(std::cin >> value);
+    if (!ok) std::cin.clear();
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    return ok;
+}
+
+// Prints a reminder from the scheduler thread in one write, so it does not interleave
+// with the menu text.
+static void printReminder(const smarttodo::Reminder& reminder) {
+    std::string text = "\n";
+    if (reminder.kind == smarttodo::ReminderKind::Overdue) {
+        text += "Overdue Task: " + reminder.description;
+    } else {
+        text += "Due Soon: " + reminder.description + " due by " + smarttodo::formatDateTime(reminder.dueTime);
+    }
+    std::cout << text + "\n" << std::flush;
+}
+
+static const std::string snapshotFilename = "tasks.db";
+static const std::string journalFilename = "tasks.wal";
+static const std::string dataFilename = "tasks.txt";
+
+// The snapshot plus its journal is the primary store; tasks.txt is imported only when
+// neither exists yet. Every change is journaled as it happens.
+static void openStore(smarttodo::BucketToDoList& toDoList, std::ostream& out) {
+    if (!std::ifstream(snapshotFilename) && !std::ifstream(journalFilename)) {
+        smarttodo::LoadStats imported = toDoList.loadFromFile(dataFilename);
+        if (imported.rejected) {
+            out << "Imported " << imported.loaded << " tasks from " << dataFilename << " ("
+                << imported.rejected << " malformed lines skipped)\n";
+        }
+    }
+    if (!toDoList.openJournal(snapshotFilename, journalFilename)) {
+        std::cerr << "Failed to open " << snapshotFilename << " / " << journalFilename
+                  << "; changes will not be saved" << std::endl;
+    }
+}
+
+// Runs a command script (see include/batch.h) from `path`, or stdin for "-", printing
+// only results, then a timing summary on stderr. Exits non-zero if any command failed.
+// With `listsDir`, scripts work on the named lists there ("use <name>", see batch.h).
+static int runBatchMode(const std::string& path, std::size_t maxTasks, bool save, const std::string& listsDir) {
+    std::ios::sync_with_stdio(false);
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = path == "-" ? std::cin : file;
+
+    smarttodo::BatchOutputBuffer buffer(std::cout.rdbuf());
+    std::ostream out(&buffer);
+    smarttodo::BatchStats stats;
+    if (!listsDir.empty()) {
+        smarttodo::ListManagerOptions options;
+        options.maxTasksPerList = maxTasks;
+        options.out = &out;
+        smarttodo::ListManager lists(listsDir, options);
+        stats = smarttodo::runBatch(lists, in, out);
+    } else {
+        smarttodo::BucketToDoList toDoList(out, maxTasks);
+        if (save) openStore(toDoList, out);
+        stats = smarttodo::runBatch(toDoList, in, out);
+        if (save && !toDoList.checkpoint()) out << "Failed to save tasks to " << snapshotFilename << "\n";
+    }
+    buffer.drain();
+
+    const double ms = std::chrono::duration<double, std::milli>(stats.elapsed).count();
+    std::cerr << "Batch: " << stats.commands << " commands (" << stats.failed << " failed) in " << ms
+              << " ms, " << static_cast<std::uint64_t>(ms > 0 ? stats.commands * 1000.0 / ms : 0)
+              << " commands/s" << std::endl;
+    return stats.failed ? 1 : 0;
+}
+
+static smarttodo::TaskServer* runningServer = nullptr;
+
+static void stopServer(int) {
+    if (runningServer) runningServer->stop();
+}
+
+// Holds the list in memory and serves it on `socketPath` until SIGINT/SIGTERM, then
+// saves. Changes are journaled as they happen, as in the interactive mode.
+static int runServer(const std::string& socketPath, std::size_t maxTasks, bool save) {
+    smarttodo::TaskServer server(maxTasks);
+    if (save) openStore(server.list(), std::cerr);
+    if (!server.listen(socketPath)) {
+        std::cerr << "Cannot listen on " << socketPath << std::endl;
+        return 1;
+    }
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cerr << "Serving " << server.list().size() << " tasks on " << socketPath << std::endl;
+    bool ok = server.serve();
+    runningServer = nullptr;
+    if (save && !server.list().checkpoint()) {
+        std::cerr << "Failed to save tasks to " << snapshotFilename << std::endl;
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+// Sends `command` to the server, or every line of stdin when it is empty, keeping up to
+// a window of requests in flight. Prints the responses in order; errors go to stderr.
+static int runClient(const std::string& socketPath, const std::string& command) {
+    std::ios::sync_with_stdio(false);
+    smarttodo::TaskClient client;
+    if (!client.connect(socketPath)) {
+        std::cerr << "Cannot connect to " << socketPath << std::endl;
+        return 1;
+    }
+    const std::size_t window = 256;
+    bool failed = false;
+    bool lost = false;
+    auto receiveOne = [&] {
+        auto response = client.receive();
+        if (!response) {
+            lost = true;
+            return;
+        }
+        if (response->ok) std::cout << response->body;
+        else std::cerr << "Error: " << response->body << "\n";
+        failed |= !response->ok;
+    };
+    std::string line;
+    if (!command.empty()) {
+        client.send(command);
+    } else {
+        while (!lost && std::getline(std::cin, line)) {
+            if (!client.send(line)) lost = true;
+            if (client.inFlight() >= window) receiveOne();
+        }
+    }
+    while (!lost && client.inFlight()) receiveOne();
+    std::cout << std::flush;
+    if (lost) std::cerr << "Connection to " << socketPath << " lost" << std::endl;
+    return failed || lost ? 1 : 0;
+}
+
+static int usage() {
+    std::cerr << "Usage: smarttodo_app [--batch [FILE|-]] [--max-tasks N] [--no-save]\n"
+                 "       smarttodo_app --lists DIR [--list NAME | --batch [FILE|-]] [--max-tasks N]\n"
+                 "       smarttodo_app --serve [--socket PATH] [--max-tasks N] [--no-save]\n"
+                 "       smarttodo_app --client [--socket PATH] [COMMAND...]\n"
+                 "Any mode but --client also takes --metrics-file PATH [--metrics-interval SECONDS]\n";
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    std::size_t maxTasks = smarttodo::BucketToDoList::kDefaultMaxTasks;
+    std::string batchPath;
+    std::string socketPath = "tasks.sock";
+    bool save = true;
+    bool serve = false;
+    bool client = false;
+    std::string command;
+    std::string metricsPath;
+    std::string listsDir;
+    std::string listName;
+    long metricsInterval = 15;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (client && arg.rfind("--", 0) != 0) { // the rest is the command
+            for (; i < argc; ++i) command += (command.empty() ? "" : " ") + std::string(argv[i]);
+            break;
+        }
+        if (arg == "--serve") {
+            serve = true;
+        } else if (arg == "--client") {
+            client = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--batch") {
+            bool hasPath = i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0;
+            batchPath = hasPath ? argv[++i] : "-";
+        } else if (arg == "--max-tasks" && i + 1 < argc) {
+            maxTasks = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--lists" && i + 1 < argc) {
+            listsDir = argv[++i];
+        } else if (arg == "--list" && i + 1 < argc) {
+            listName = argv[++i];
+        } else if (arg == "--no-save") {
+            save = false;
+        } else if (arg == "--metrics-file" && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            metricsInterval = std::strtol(argv[++i], nullptr, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (serve + client + !batchPath.empty() > 1 || (client && !metricsPath.empty())) return usage();
+    // named lists are always journaled; the daemon serves a single list
+    if ((!listsDir.empty() || !listName.empty()) && (serve || client || !save)) return usage();
+    if (!listName.empty() && (listsDir.empty() || !batchPath.empty())) return usage();
+    std::unique_ptr<smarttodo::metrics::MetricsDumper> metricsDumper;
+    if (!metricsPath.empty()) {
+        metricsDumper = std::make_unique<smarttodo::metrics::MetricsDumper>(
+            metricsPath, std::chrono::seconds(metricsInterval));
+    }
+    if (serve) return runServer(socketPath, maxTasks, save);
+    if (client) return runClient(socketPath, command);
+    if (!batchPath.empty()) return runBatchMode(batchPath, maxTasks, save, listsDir);
+    if (!listsDir.empty() && listName.empty()) return usage();
+
+    // Declared before the list so it outlives it.
+    smarttodo::ReminderScheduler reminders(printReminder, std::chrono::hours(24));
+    smarttodo::BucketToDoList defaultList(std::cout, maxTasks);
+    std::unique_ptr<smarttodo::ListManager> lists;
+    smarttodo::ListManager::Handle named;
+    if (!listName.empty()) {
+        smarttodo::ListManagerOptions options;
+        options.maxTasksPerList = maxTasks;
+        lists = std::make_unique<smarttodo::ListManager>(listsDir, options);
+        named = lists->open(listName);
+        if (!named) {
+            std::cerr << "Cannot open list '" << listName << "' in " << listsDir << std::endl;
+            return 1;
+        }
+    }
+    smarttodo::BucketToDoList& toDoList = named ? *named : defaultList;
+    const std::string storeName = named ? "list '" + listName + "'" : snapshotFilename;
     const std::string csvFilename = "tasks_export.csv";
+    const std::size_t pageSize = 20;
 
-    toDoList.loadFromFile(dataFilename);
+    if (save && !named) openStore(toDoList, std::cout);
     std::cout << "\n--- Task Reminders on Startup ---\n";
     toDoList.remindUrgentTasks();
+    // From here on reminders fire as tasks become due soon or overdue.
+    toDoList.attachReminders(&reminders);
 
     char choice{};
     int priority{};
+    smarttodo::TaskId id{};
     std::string description;
     std::string dueDate;
+    std::string repeat;
 
     do {
         std::cout << "\nSmart To-Do List\n";
@@ -23,7 +268,14 @@ int main() {
                   << "r. Remove Task\n"
                   << "v. View Tasks\n"
                   << "p. Peek Task\n"
+                  << "s. Search Tasks\n"
+                  << "u. Update Task Priority\n"
+                  << "d. Delete Task by ID\n"
+                  << "b. Make a Task Wait for Another\n"
                   << "x. Export Tasks to CSV\n"
+                  << "i. Import Tasks from CSV\n"
+                  << "t. Show Statistics\n"
+                  << "w. Save Now\n"
                   << "e. Exit\n"
                   << "Enter your choice: ";
 
@@ -46,13 +298,21 @@ int main() {
                     break;
                 }
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                if (priority < 1 || priority > 5) {
+                if (priority < smarttodo::kMinPriority || priority > smarttodo::kMaxPriority) {
                     std::cout << "Invalid priority! Please enter 1 to 5.\n";
                     break;
                 }
                 std::cout << "Enter Due Date and Time (YYYY-MM-DD HH:MM) or leave empty: ";
                 std::getline(std::cin, dueDate);
-                toDoList.insertTask(priority, description, dueDate);
+                std::cout << "Repeat every (e.g. 1d, 2w, 1m) or leave empty: ";
+                std::getline(std::cin, repeat);
+                if (repeat.empty()) {
+                    toDoList.insertTask(priority, description, dueDate);
+                } else if (auto rule = smarttodo::parseRecurrence(repeat)) {
+                    toDoList.insertRecurring(priority, description, dueDate, *rule);
+                } else {
+                    std::cout << "Invalid repeat! Use a count and d, w or m, such as 2w.\n";
+                }
                 break;
 
             case 'r': case 'R':
@@ -60,20 +320,92 @@ int main() {
                 break;
 
             case 'v': case 'V':
-                toDoList.displayTasks();
+                for (std::size_t offset = 0;; offset += pageSize) {
+                    toDoList.displayTasks(offset, pageSize);
+                    if (offset + pageSize >= toDoList.size()) break;
+                    std::string more;
+                    std::cout << "Show more? (y/n): ";
+                    std::getline(std::cin, more);
+                    if (more != "y" && more != "Y") break;
+                }
                 break;
 
             case 'p': case 'P':
                 toDoList.peekTask();
                 break;
 
+            case 's': case 'S': {
+                std::cout << "Search for: ";
+                std::getline(std::cin, description);
+                std::vector<smarttodo::TaskView> found = toDoList.search(description, pageSize);
+                if (found.empty()) std::cout << "No matching tasks\n";
+                for (const auto& task : found) {
+                    std::cout << "ID: " << task.id << " | Priority: " << task.priority
+                              << " | Task: " << task.description << "\n";
+                }
+                break;
+            }
+
+            case 'u': case 'U':
+                if (!promptNumber("Enter Task ID: ", id) ||
+                    !promptNumber("Enter New Priority (1-5, 1 = Highest): ", priority) ||
+                    priority < smarttodo::kMinPriority || priority > smarttodo::kMaxPriority) {
+                    std::cout << "Invalid input\n";
+                    break;
+                }
+                if (!toDoList.updatePriority(id, priority)) std::cout << "No task with ID " << id << "\n";
+                break;
+
+            case 'd': case 'D':
+                if (!promptNumber("Enter Task ID: ", id)) {
+                    std::cout << "Invalid input\n";
+                    break;
+                }
+                if (!toDoList.remove(id)) std::cout << "No task with ID " << id << "\n";
+                break;
+
+            case 'b': case 'B': {
+                smarttodo::TaskId prerequisite{};
+                if (!promptNumber("Enter ID of the task that waits: ", id) ||
+                    !promptNumber("Enter ID of the task it waits for: ", prerequisite)) {
+                    std::cout << "Invalid input\n";
+                    break;
+                }
+                if (!toDoList.get(id)) std::cout << "No task with ID " << id << "\n";
+                else if (!toDoList.get(prerequisite)) std::cout << "No task with ID " << prerequisite << "\n";
+                else toDoList.addDependency(id, prerequisite);
+                break;
+            }
+
             case 'x': case 'X':
                 toDoList.exportToCSV(csvFilename);
                 break;
 
+            case 'i': case 'I': {
+                std::cout << "Enter CSV file to import: ";
+                std::string path;
+                std::getline(std::cin, path);
+                for (const auto& e : toDoList.importFromCSV(path).errors) {
+                    if (e.line) std::cout << "Line " << e.line << ": ";
+                    std::cout << e.reason << "\n";
+                }
+                break;
+            }
+
+            case 'w': case 'W':
+                if (!save) std::cout << "Saving is off (--no-save)\n";
+                else if (toDoList.checkpointInBackground()) std::cout << "Saving in the background\n";
+                else std::cout << "Failed to start saving tasks to " << storeName << "\n";
+                break;
+
+            case 't': case 'T':
+                smarttodo::metrics::writeTable(std::cout, smarttodo::metrics::snapshot());
+                break;
+
             case 'e': case 'E':
-                toDoList.saveToFile(dataFilename);
-                std::cout << "Tasks saved. Goodbye!\n";
+                if (!save) std::cout << "Goodbye!\n";
+                else if (toDoList.checkpoint()) std::cout << "Tasks saved. Goodbye!\n";
+                else std::cout << "Failed to save tasks to " << storeName << "\n";
                 break;
 
             default:
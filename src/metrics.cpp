@@ -0,0 +1,259 @@
+#include "../include/metrics.h"
+#include "fs_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace smarttodo {
+namespace metrics {
+
+namespace {
+
+const char* const kOpNames[kOpCount] = {"insert", "remove", "load", "save", "display"};
+
+// `value` must be nonzero.
+unsigned log2Floor(std::uint64_t value) {
+#if defined(__GNUC__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned log = 0;
+    while (value >>= 1) ++log;
+    return log;
+#endif
+}
+
+// One thread's counters. Only the owning thread writes them, with plain load+store
+// rather than a locked read-modify-write; snapshot() reads them from other threads.
+struct Recorder {
+    struct Counters {
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> totalNs{0};
+        std::atomic<std::uint64_t> maxNs{0};
+        std::array<std::atomic<std::uint64_t>, Histogram::kBuckets> buckets{};
+    };
+
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    void addTo(std::array<Histogram, kOpCount>& out) const {
+        for (std::size_t op = 0; op < kOpCount; ++op) {
+            const Counters& from = ops[op];
+            Histogram& to = out[op];
+            to.count += from.count.load(std::memory_order_relaxed);
+            to.totalNs += from.totalNs.load(std::memory_order_relaxed);
+            to.maxNs = std::max(to.maxNs, from.maxNs.load(std::memory_order_relaxed));
+            for (std::size_t b = 0; b < Histogram::kBuckets; ++b) {
+                to.buckets[b] += from.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::array<Counters, kOpCount> ops;
+};
+
+// Never destroyed: threads can still exit, and fold their counts in, during static
+// destruction.
+struct Registry {
+    std::mutex mutex;
+    std::vector<const Recorder*> live;
+    std::array<Histogram, kOpCount> exited; // threads that have finished
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+// starts the elapsed clock at program start rather than at the first operation
+const Registry& startClock = registry();
+
+// Registers the thread's recorder on its first operation and folds its counts into the
+// registry when the thread exits.
+struct RecorderOwner {
+    RecorderOwner() : recorder(std::make_unique<Recorder>()) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(recorder.get());
+    }
+    ~RecorderOwner() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        recorder->addTo(r.exited);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), recorder.get()));
+    }
+
+    std::unique_ptr<Recorder> recorder;
+};
+
+Recorder& localRecorder() {
+    // the plain pointer keeps the common path free of thread_local constructor checks
+    thread_local Recorder* current = nullptr;
+    if (current) return *current;
+    thread_local RecorderOwner owner;
+    current = owner.recorder.get();
+    return *current;
+}
+
+std::string formatDuration(double ns) {
+    char text[32];
+    if (ns < 1e3) std::snprintf(text, sizeof(text), "%.0f ns", ns);
+    else if (ns < 1e6) std::snprintf(text, sizeof(text), "%.1f us", ns / 1e3);
+    else if (ns < 1e9) std::snprintf(text, sizeof(text), "%.1f ms", ns / 1e6);
+    else std::snprintf(text, sizeof(text), "%.2f s", ns / 1e9);
+    return text;
+}
+
+std::string formatSeconds(double seconds) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", seconds);
+    return text;
+}
+
+} // namespace
+
+const char* opName(Op op) { return kOpNames[static_cast<std::size_t>(op)]; }
+
+std::size_t Histogram::bucketOf(std::uint64_t ns) {
+    if (ns < kSubBuckets) return static_cast<std::size_t>(ns);
+    const unsigned log = log2Floor(ns);
+    const std::uint64_t sub = (ns >> (log - kSubBits)) & (kSubBuckets - 1);
+    return (log - kSubBits + 1) * kSubBuckets + static_cast<std::size_t>(sub);
+}
+
+std::uint64_t Histogram::lowerBound(std::size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    const unsigned log = static_cast<unsigned>(bucket / kSubBuckets) + kSubBits - 1;
+    return (kSubBuckets + bucket % kSubBuckets) << (log - kSubBits);
+}
+
+std::uint64_t Histogram::upperBound(std::size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    const unsigned log = static_cast<unsigned>(bucket / kSubBuckets) + kSubBits - 1;
+    return lowerBound(bucket) + ((std::uint64_t{1} << (log - kSubBits)) - 1);
+}
+
+std::uint64_t Histogram::quantile(double q) const {
+    if (count == 0) return 0;
+    const auto rank = static_cast<std::uint64_t>(std::max(1.0, q * static_cast<double>(count) + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return std::min(upperBound(b), maxNs);
+    }
+    return maxNs;
+}
+
+std::uint64_t Histogram::countAtMost(std::uint64_t ns) const {
+    std::uint64_t total = 0;
+    for (std::size_t b = 0; b < kBuckets && upperBound(b) <= ns; ++b) total += buckets[b];
+    return total;
+}
+
+void record(Op op, std::uint64_t ns) {
+    Recorder::Counters& c = localRecorder().ops[static_cast<std::size_t>(op)];
+    Recorder::bump(c.count, 1);
+    Recorder::bump(c.totalNs, ns);
+    Recorder::bump(c.buckets[Histogram::bucketOf(ns)], 1);
+    if (ns > c.maxNs.load(std::memory_order_relaxed)) c.maxNs.store(ns, std::memory_order_relaxed);
+}
+
+Snapshot snapshot() {
+    Registry& r = registry();
+    Snapshot stats;
+    std::lock_guard<std::mutex> lock(r.mutex);
+    stats.ops = r.exited;
+    for (const Recorder* recorder : r.live) recorder->addTo(stats.ops);
+    stats.elapsed = std::chrono::steady_clock::now() - r.start;
+    return stats;
+}
+
+void writeTable(std::ostream& out, const Snapshot& stats) {
+    if (!kEnabled) {
+        out << "Statistics are not available: built without SMARTTODO_METRICS\n";
+        return;
+    }
+    const double seconds = std::chrono::duration<double>(stats.elapsed).count();
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-9s %10s %10s %10s %10s %10s %10s\n", "Operation", "Count", "Per sec",
+                  "Mean", "p50", "p99", "Max");
+    out << line;
+    for (std::size_t op = 0; op < kOpCount; ++op) {
+        const Histogram& h = stats.ops[op];
+        const double mean = h.count ? static_cast<double>(h.totalNs) / static_cast<double>(h.count) : 0.0;
+        std::snprintf(line, sizeof(line), "%-9s %10llu %10.1f %10s %10s %10s %10s\n", kOpNames[op],
+                      static_cast<unsigned long long>(h.count),
+                      seconds > 0 ? static_cast<double>(h.count) / seconds : 0.0, formatDuration(mean).c_str(),
+                      formatDuration(static_cast<double>(h.quantile(0.5))).c_str(),
+                      formatDuration(static_cast<double>(h.quantile(0.99))).c_str(),
+                      formatDuration(static_cast<double>(h.maxNs)).c_str());
+        out << line;
+    }
+}
+
+void writePrometheus(std::ostream& out, const Snapshot& stats) {
+    // 1, 2.5 and 5 of each decade from 1 us to 10 s
+    static const double kBounds[] = {1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3,
+                                     5e-3, 1e-2, 2.5e-2, 5e-2, 0.1,    0.25,   0.5,  1,    2.5,    5,    10};
+    const char* name = "smarttodo_operation_duration_seconds";
+    out << "# HELP " << name << " Time spent in ToDoList operations.\n";
+    out << "# TYPE " << name << " histogram\n";
+    for (std::size_t op = 0; op < kOpCount; ++op) {
+        const Histogram& h = stats.ops[op];
+        const std::string label = std::string("op=\"") + kOpNames[op] + "\"";
+        for (double bound : kBounds) {
+            out << name << "_bucket{" << label << ",le=\"" << formatSeconds(bound) << "\"} "
+                << h.countAtMost(static_cast<std::uint64_t>(bound * 1e9 + 0.5)) << "\n";
+        }
+        out << name << "_bucket{" << label << ",le=\"+Inf\"} " << h.count << "\n";
+        out << name << "_sum{" << label << "} " << formatSeconds(static_cast<double>(h.totalNs) / 1e9) << "\n";
+        out << name << "_count{" << label << "} " << h.count << "\n";
+    }
+    out << "# HELP smarttodo_operation_max_seconds Slowest single ToDoList operation.\n";
+    out << "# TYPE smarttodo_operation_max_seconds gauge\n";
+    for (std::size_t op = 0; op < kOpCount; ++op) {
+        out << "smarttodo_operation_max_seconds{op=\"" << kOpNames[op] << "\"} "
+            << formatSeconds(static_cast<double>(stats.ops[op].maxNs) / 1e9) << "\n";
+    }
+}
+
+bool dumpToFile(const std::string& path) {
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        if (!file) return false;
+        writePrometheus(file, snapshot());
+        if (!file.flush()) return false;
+    }
+    return replaceFile(temp, path);
+}
+
+MetricsDumper::MetricsDumper(std::string path, std::chrono::seconds interval)
+    : path_(std::move(path)), interval_(std::max(interval, std::chrono::seconds(1))), thread_([this] { run(); }) {}
+
+MetricsDumper::~MetricsDumper() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    dumpToFile(path_);
+}
+
+void MetricsDumper::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, interval_, [this] { return stop_; })) {
+        lock.unlock();
+        dumpToFile(path_);
+        lock.lock();
+    }
+}
+
+} // namespace metrics
+} // namespace smarttodo
@@ -0,0 +1,112 @@
+#include "../include/todo.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace smarttodo {
+
+// Query planning. Each bound a query sets can be served by one sorted index: priority
+// by the queue's own walk, due times by the due index, creation times by the creation
+// index. Sizes of std::set ranges are not known without walking them, so the planner
+// walks all usable ranges in (weighted) lockstep, each collecting its matches, and the first to
+// run out wins. The queue walk always takes part: it yields the most urgent tasks
+// first, so it is also done once it holds `limit` matches, which makes it the winner
+// for most limited queries. Either way the cost is at most a few times that of the
+// cheapest plan, and nothing proportional to the list.
+namespace {
+
+using TimeIndex = std::set<std::pair<std::time_t, std::uint32_t>>;
+
+// A walk step costs several index steps (the heap's walk keeps a frontier heap), so
+// the index ranges move this many steps for each one of the walk.
+const int kIndexStepsPerWalkStep = 4;
+
+// The slots of one index range, in index order.
+struct TimeRange {
+    TimeIndex::const_iterator at, end;
+
+    TimeRange(const TimeIndex& index, std::time_t min, std::time_t max)
+        : at(index.lower_bound({min, 0})),
+          end(index.upper_bound({max, std::numeric_limits<std::uint32_t>::max()})) {}
+    bool done() const { return at == end; }
+    std::uint32_t slot() const { return at->second; }
+    void next() { ++at; }
+};
+
+// The queue walked from the top until priorities pass `max`. Tasks below the range
+// minimum are stepped over, so they count toward this range's size.
+template <typename Queue>
+struct QueueRange {
+    const Queue* queue;
+    typename Queue::Walk walk;
+    int max;
+
+    QueueRange(const Queue& q, int maxPriority) : queue(&q), walk(q), max(maxPriority) {}
+    bool done() const { return walk.done() || queue->priority(walk.slot()) > max; }
+    std::uint32_t slot() const { return walk.slot(); }
+    void next() { walk.next(); }
+};
+
+} // namespace
+
+template <typename Queue>
+std::vector<TaskView> BasicToDoList<Queue>::query(const TaskQuery& q, std::size_t limit) const {
+    std::vector<TaskView> found;
+    if (limit == 0 || q.minPriority > q.maxPriority || q.dueMin > q.dueMax || q.createdMin > q.createdMax) {
+        return found;
+    }
+    auto matches = [&](std::uint32_t slot) {
+        if (isBlocked(slot)) return false; // found through an index, but not ready
+        const int priority = queue_.priority(slot);
+        return priority >= q.minPriority && priority <= q.maxPriority && due(slot) >= q.dueMin &&
+               due(slot) <= q.dueMax && created(slot) >= q.createdMin && created(slot) <= q.createdMax;
+    };
+
+    // The due index holds only tasks with a due date, so it serves a range that stops
+    // short of kNoTime.
+    const bool byDue = q.dueMax != kNoTime;
+    const bool byCreated = q.createdMin != std::numeric_limits<std::time_t>::min() || q.createdMax != kNoTime;
+    TimeRange dueScan(dueIndex_, q.dueMin, q.dueMax);
+    TimeRange createdScan(createdIndex_, q.createdMin, q.createdMax);
+    QueueRange<Queue> walk(queue_, q.maxPriority);
+    // Every cursor keeps its own matches, so the winner's are ready when it finishes.
+    // Priorities only grow along the walk, so its first `limit` matches are the most urgent.
+    std::vector<TaskView> dueFound, createdFound;
+    auto step = [&](TimeRange& range, std::vector<TaskView>& out) {
+        if (matches(range.slot())) out.push_back(view(range.slot()));
+        range.next();
+    };
+    for (;;) {
+        if (walk.done() || found.size() >= limit) break;
+        if (matches(walk.slot())) found.push_back(view(walk.slot()));
+        walk.next();
+        for (int i = 0; i < kIndexStepsPerWalkStep; ++i) {
+            if (byDue && !dueScan.done()) step(dueScan, dueFound);
+            if (byCreated && !createdScan.done()) step(createdScan, createdFound);
+        }
+        if (byDue && dueScan.done()) {
+            found.swap(dueFound);
+            break;
+        }
+        if (byCreated && createdScan.done()) {
+            found.swap(createdFound);
+            break;
+        }
+    }
+
+    auto urgentFirst = [](const TaskView& a, const TaskView& b) {
+        return a.priority != b.priority ? a.priority < b.priority : a.id < b.id;
+    };
+    if (found.size() > limit) {
+        std::partial_sort(found.begin(), found.begin() + limit, found.end(), urgentFirst);
+        found.resize(limit);
+    } else {
+        std::sort(found.begin(), found.end(), urgentFirst);
+    }
+    return found;
+}
+
+template std::vector<TaskView> BasicToDoList<HeapQueue>::query(const TaskQuery&, std::size_t) const;
+template std::vector<TaskView> BasicToDoList<PriorityBuckets>::query(const TaskQuery&, std::size_t) const;
+
+} // namespace smarttodo
@@ -0,0 +1,127 @@
+#include "../include/reminder_scheduler.h"
+
+#include <algorithm>
+
+namespace smarttodo {
+
+namespace {
+
+const std::size_t kMinCompactStale = 1024;
+// Longest single sleep. Far-future due dates would overflow the clocks' nanosecond
+// counts, and a bounded sleep also limits drift after the wall clock is changed.
+const std::time_t kMaxSleepSeconds = 3600;
+
+} // namespace
+
+ReminderScheduler::ReminderScheduler(Callback callback, std::chrono::seconds leadTime)
+    : callback_(std::move(callback)), leadTime_(leadTime), thread_([this] { run(); }) {}
+
+ReminderScheduler::~ReminderScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void ReminderScheduler::schedule(TaskId id, std::string_view description, std::time_t dueTime) {
+    const std::time_t now = std::time(nullptr);
+    const std::time_t soonAt = dueTime - static_cast<std::time_t>(leadTime_.count());
+    const std::time_t overdueAt = dueTime + 1; // overdue means strictly past due
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it != entries_.end()) dropEntry(it);
+    if (overdueAt <= now) return;
+
+    const std::uint32_t generation = nextGeneration_++;
+    Entry& entry = entries_[id];
+    entry = Entry{std::string(description), dueTime, generation, 0};
+    if (soonAt > now && leadTime_.count() > 0) {
+        push(Event{soonAt, id, generation, ReminderKind::DueSoon});
+        ++entry.events;
+    }
+    push(Event{overdueAt, id, generation, ReminderKind::Overdue});
+    ++entry.events;
+}
+
+void ReminderScheduler::cancel(TaskId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) return;
+    dropEntry(it);
+    if (staleEvents_ > kMinCompactStale && staleEvents_ > events_.size() / 2) compact();
+}
+
+void ReminderScheduler::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.clear();
+    entries_.clear();
+    staleEvents_ = 0;
+}
+
+std::size_t ReminderScheduler::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+// Caller holds the lock. Wakes the thread only when the new event comes first; anything
+// later is picked up when the thread next looks at the heap anyway.
+void ReminderScheduler::push(const Event& event) {
+    const bool earliest = events_.empty() || event.at < events_.front().at;
+    events_.push_back(event);
+    std::push_heap(events_.begin(), events_.end(), later);
+    if (earliest) wake_.notify_one();
+}
+
+void ReminderScheduler::dropEntry(std::unordered_map<TaskId, Entry>::iterator it) {
+    staleEvents_ += it->second.events;
+    entries_.erase(it);
+}
+
+void ReminderScheduler::compact() {
+    auto live = [this](const Event& e) {
+        auto it = entries_.find(e.id);
+        return it != entries_.end() && it->second.generation == e.generation;
+    };
+    events_.erase(std::remove_if(events_.begin(), events_.end(),
+                                 [&](const Event& e) { return !live(e); }),
+                  events_.end());
+    std::make_heap(events_.begin(), events_.end(), later);
+    staleEvents_ = 0;
+}
+
+void ReminderScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<Reminder> due;
+    while (!stop_) {
+        if (events_.empty()) {
+            wake_.wait(lock);
+            continue;
+        }
+        const std::time_t now = std::time(nullptr);
+        if (events_.front().at > now) {
+            wake_.wait_for(lock, std::chrono::seconds(std::min(events_.front().at - now, kMaxSleepSeconds)));
+            continue;
+        }
+        while (!events_.empty() && events_.front().at <= now) {
+            std::pop_heap(events_.begin(), events_.end(), later);
+            Event event = events_.back();
+            events_.pop_back();
+            auto it = entries_.find(event.id);
+            if (it == entries_.end() || it->second.generation != event.generation) {
+                if (staleEvents_) --staleEvents_;
+                continue;
+            }
+            Entry& entry = it->second;
+            due.push_back(Reminder{event.kind, event.id, entry.description, entry.dueTime});
+            if (--entry.events == 0) entries_.erase(it);
+        }
+        lock.unlock();
+        for (const Reminder& reminder : due) callback_(reminder);
+        due.clear();
+        lock.lock();
+    }
+}
+
+} // namespace smarttodo
@@ -0,0 +1,197 @@
+#include "../include/search_index.h"
+
+#include <algorithm>
+
+namespace smarttodo {
+
+namespace {
+
+const std::size_t kMinRebuildDead = 1024;
+const std::uint32_t kBlockSize = 128;
+
+unsigned char fold(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return u >= 'A' && u <= 'Z' ? static_cast<unsigned char>(u + ('a' - 'A')) : u;
+}
+
+std::uint32_t trigram(const char* p) {
+    return std::uint32_t{fold(p[0])} << 16 | std::uint32_t{fold(p[1])} << 8 | fold(p[2]);
+}
+
+std::uint32_t readVarint(const std::uint8_t*& p) {
+    std::uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        std::uint8_t byte = *p++;
+        value |= std::uint32_t{byte & 0x7Fu} << shift;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+} // namespace
+
+void SearchIndex::PostingList::append(std::uint32_t doc) {
+    if (count && doc == last) return; // trigram repeated within one description
+    if (count % kBlockSize == 0) {
+        heads.push_back(doc);
+        offsets.push_back(static_cast<std::uint32_t>(bytes.size()));
+    } else {
+        for (std::uint32_t delta = doc - last; ; delta >>= 7) {
+            if (delta < 0x80) {
+                bytes.push_back(static_cast<std::uint8_t>(delta));
+                break;
+            }
+            bytes.push_back(static_cast<std::uint8_t>(delta | 0x80));
+        }
+    }
+    last = doc;
+    ++count;
+}
+
+std::vector<std::uint32_t> SearchIndex::PostingList::decode() const {
+    std::vector<std::uint32_t> docs;
+    docs.reserve(count);
+    const std::uint8_t* p = bytes.data();
+    for (std::size_t b = 0; b < heads.size(); ++b) {
+        std::uint32_t doc = heads[b];
+        docs.push_back(doc);
+        const std::uint32_t n = std::min<std::uint32_t>(kBlockSize, count - b * kBlockSize);
+        for (std::uint32_t i = 1; i < n; ++i) docs.push_back(doc += readVarint(p));
+    }
+    return docs;
+}
+
+// Forward-only walk over a posting list, skipping whole blocks by their heads.
+class SearchIndex::Cursor {
+public:
+    explicit Cursor(const PostingList& list) : list_(list) { enterBlock(0); }
+
+    // Moves to the first document >= target; false once the list is exhausted.
+    bool seek(std::uint32_t target) {
+        if (doc_ >= target) return true;
+        const auto& heads = list_.heads;
+        if (block_ + 1 < heads.size() && heads[block_ + 1] <= target) {
+            auto it = std::upper_bound(heads.begin() + block_ + 1, heads.end(), target);
+            enterBlock(static_cast<std::size_t>(it - heads.begin()) - 1);
+        }
+        while (doc_ < target) {
+            if (index_ + 1 < blockLength()) {
+                doc_ += readVarint(p_);
+                ++index_;
+            } else if (block_ + 1 < heads.size()) {
+                enterBlock(block_ + 1);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::uint32_t doc() const { return doc_; }
+
+private:
+    void enterBlock(std::size_t block) {
+        block_ = block;
+        index_ = 0;
+        doc_ = list_.heads[block];
+        p_ = list_.bytes.data() + list_.offsets[block];
+    }
+
+    std::uint32_t blockLength() const {
+        return std::min<std::uint32_t>(kBlockSize, list_.count - static_cast<std::uint32_t>(block_) * kBlockSize);
+    }
+
+    const PostingList& list_;
+    std::size_t block_ = 0;
+    std::uint32_t index_ = 0;
+    std::uint32_t doc_ = 0;
+    const std::uint8_t* p_ = nullptr;
+};
+
+void SearchIndex::add(std::uint64_t id, std::string_view description) {
+    const std::uint32_t doc = static_cast<std::uint32_t>(ids_.size());
+    ids_.push_back(id);
+    for (std::size_t i = 0; i + 3 <= description.size(); ++i) {
+        postings_[trigram(description.data() + i)].append(doc);
+    }
+}
+
+bool SearchIndex::needsRebuild() const {
+    return dead_ > kMinRebuildDead && dead_ > ids_.size() - dead_;
+}
+
+void SearchIndex::clear() {
+    postings_.clear();
+    ids_.clear();
+    dead_ = 0;
+}
+
+std::vector<std::string> SearchIndex::terms(std::string_view query) {
+    std::vector<std::string> out;
+    std::string term;
+    for (char c : query) {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            if (!term.empty()) out.push_back(std::move(term));
+            term.clear();
+        } else {
+            term += static_cast<char>(fold(c));
+        }
+    }
+    if (!term.empty()) out.push_back(std::move(term));
+    return out;
+}
+
+bool SearchIndex::matches(std::string_view text, std::string_view term) {
+    if (term.size() > text.size()) return false;
+    for (std::size_t i = 0; i + term.size() <= text.size(); ++i) {
+        std::size_t k = 0;
+        while (k < term.size() && fold(text[i + k]) == static_cast<unsigned char>(term[k])) ++k;
+        if (k == term.size()) return true;
+    }
+    return false;
+}
+
+std::optional<std::vector<std::uint64_t>> SearchIndex::candidates(
+    const std::vector<std::string>& terms) const {
+    std::vector<const PostingList*> lists;
+    for (const auto& term : terms) {
+        for (std::size_t i = 0; i + 3 <= term.size(); ++i) {
+            auto it = postings_.find(trigram(term.data() + i));
+            if (it == postings_.end()) return std::vector<std::uint64_t>{};
+            lists.push_back(&it->second);
+        }
+    }
+    if (lists.empty()) return std::nullopt;
+
+    // intersect starting from the rarest trigram; the cursors skip whole blocks, so the
+    // cost follows the candidates left rather than the length of the common lists
+    std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->count < b->count; });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    std::vector<std::uint32_t> docs = lists.front()->decode();
+    for (std::size_t l = 1; l < lists.size() && !docs.empty(); ++l) {
+        Cursor cursor(*lists[l]);
+        std::size_t kept = 0;
+        for (std::uint32_t doc : docs) {
+            if (!cursor.seek(doc)) break;
+            if (cursor.doc() == doc) docs[kept++] = doc;
+        }
+        docs.resize(kept);
+    }
+
+    std::vector<std::uint64_t> ids;
+    ids.reserve(docs.size());
+    for (std::uint32_t doc : docs) ids.push_back(ids_[doc]);
+    return ids;
+}
+
+std::size_t SearchIndex::memoryUsage() const {
+    std::size_t bytes = ids_.capacity() * sizeof(std::uint64_t) +
+                        postings_.bucket_count() * sizeof(void*);
+    for (const auto& entry : postings_) {
+        const PostingList& list = entry.second;
+        bytes += sizeof(entry) + sizeof(void*) + list.bytes.capacity() +
+                 (list.heads.capacity() + list.offsets.capacity()) * sizeof(std::uint32_t);
+    }
+    return bytes;
+}
+
+} // namespace smarttodo
@@ -0,0 +1,267 @@
+#include "../include/todo.h"
+#include "../include/metrics.h"
+#include "datetime.h"
+#include "fs_util.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace smarttodo {
+
+// Binary snapshot layout (native byte order):
+//   SnapshotHeader | TaskRecord[taskCount] | description blob | u64 rule count |
+//   RuleRecord[rule count] | u64 edge count | EdgeRecord[edge count]
+// Records are stored in the queue's order so loading needs no reordering, tasks waiting
+// on prerequisites after the ready ones. Descriptions are stored in the blob with a u32
+// length prefix, the layout StringArena uses, so a loaded list reads them straight from
+// the mapped file instead of copying each one. The rule table, one entry per recurring
+// task, is new in version 4 and the dependency edges in version 5; versions 3 and 4
+// load without them. Versions 1 and 2 kept the timestamp and due date as text next to
+// the description (version 2 added the task ID); they still load, version 1 tasks
+// getting fresh IDs.
+namespace {
+
+const char kSnapshotMagic[8] = {'S', 'T', 'D', 'O', 'S', 'N', 'A', 'P'};
+const std::uint32_t kSnapshotVersion = 5;
+const std::uint32_t kLegacyRecordSizeV1 = 32;
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t taskCount;
+    std::uint64_t recordsOffset;
+    std::uint64_t blobOffset;
+    std::uint64_t blobSize;
+    std::uint64_t lastLsn; // last journal record the snapshot reflects (0 without a journal)
+    std::uint64_t nextId;  // first ID not yet handed out (0 in version 1)
+};
+
+struct TaskRecord {
+    std::int32_t priority;
+    std::uint32_t descLen;
+    std::int64_t created;
+    std::int64_t dueTime;
+    std::uint64_t id;
+    std::uint64_t descOffset; // of the description's length prefix in the blob
+};
+
+struct RuleRecord {
+    std::uint64_t id;
+    std::uint32_t recurrence; // packed as by packRecurrence()
+    std::uint32_t reserved;
+};
+
+// `task` waits for `prerequisite`; edges to prerequisites not in the snapshot are dropped
+struct EdgeRecord {
+    std::uint64_t task;
+    std::uint64_t prerequisite;
+};
+
+struct LegacyTaskRecord {
+    std::int32_t priority;
+    std::uint32_t descLen;
+    std::int64_t dueTime;
+    std::uint64_t blobOffset;
+    std::uint16_t timestampLen;
+    std::uint16_t dueDateLen;
+    std::uint32_t reserved;
+    std::uint64_t id; // version 2
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout changed");
+static_assert(sizeof(TaskRecord) == 40, "snapshot record layout changed");
+static_assert(sizeof(RuleRecord) == 16, "snapshot rule layout changed");
+static_assert(sizeof(EdgeRecord) == 16, "snapshot edge layout changed");
+static_assert(sizeof(Dependency) == sizeof(EdgeRecord), "edges are copied as they are held");
+static_assert(sizeof(LegacyTaskRecord) == 40, "legacy snapshot record layout changed");
+
+const std::uint32_t kMaxDescLen = 0x7FFFFFFFu; // the arena's length limit
+
+} // namespace
+
+template <typename Queue>
+bool BasicToDoList<Queue>::saveSnapshot(const std::string& filename) const {
+    SMARTTODO_TIME(Save);
+    if (journal_) journal_->waitForCompaction(); // it may be writing the same file
+    return writeSnapshot(encodeSnapshot(*freeze()), filename);
+}
+
+// Reads only the frozen copy, so it may run on any thread.
+template <typename Queue>
+std::string BasicToDoList<Queue>::encodeSnapshot(const FrozenList& list) {
+    const std::size_t count = list.queue.size() + list.blocked.size();
+    SnapshotHeader h{};
+    std::memcpy(h.magic, kSnapshotMagic, sizeof(h.magic));
+    h.version = kSnapshotVersion;
+    h.recordSize = sizeof(TaskRecord);
+    h.taskCount = count;
+    h.recordsOffset = sizeof(SnapshotHeader);
+    h.blobOffset = h.recordsOffset + count * sizeof(TaskRecord);
+    h.lastLsn = list.lsn;
+    h.nextId = list.nextId;
+
+    // records are filled in place while the blob grows behind them
+    std::string image(h.blobOffset, '\0');
+    std::size_t i = 0;
+    auto record = [&](std::uint32_t slot, int priority) {
+        std::string_view desc = StringArena::view(list.descs[slot]);
+        TaskRecord r{};
+        r.priority = priority;
+        r.descLen = static_cast<std::uint32_t>(desc.size());
+        r.created = list.created[slot];
+        r.dueTime = list.due[slot];
+        r.id = list.ids[slot];
+        r.descOffset = image.size() - h.blobOffset;
+        image.append(reinterpret_cast<const char*>(&r.descLen), sizeof(r.descLen));
+        image.append(desc.data(), desc.size());
+        std::memcpy(&image[h.recordsOffset + i++ * sizeof(TaskRecord)], &r, sizeof(r));
+    };
+    list.queue.forEach(record);
+    list.blocked.forEach(record);
+    h.blobSize = image.size() - h.blobOffset;
+    const std::uint64_t ruleCount = list.rules.size();
+    image.append(reinterpret_cast<const char*>(&ruleCount), sizeof(ruleCount));
+    for (const auto& [id, rule] : list.rules) {
+        RuleRecord r{id, packRecurrence(rule), 0};
+        image.append(reinterpret_cast<const char*>(&r), sizeof(r));
+    }
+    const std::uint64_t edgeCount = list.edges.size();
+    image.append(reinterpret_cast<const char*>(&edgeCount), sizeof(edgeCount));
+    image.append(reinterpret_cast<const char*>(list.edges.data()), list.edges.size() * sizeof(EdgeRecord));
+    std::memcpy(&image[0], &h, sizeof(h));
+    return image;
+}
+
+template <typename Queue>
+bool BasicToDoList<Queue>::writeSnapshot(const std::string& image, const std::string& filename) {
+    // write-then-rename so a crash mid-save never leaves a truncated snapshot behind
+    const std::string tmp = filename + ".tmp";
+    std::FILE* file = std::fopen(tmp.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(image.data(), 1, image.size(), file) == image.size() && syncFile(file);
+    ok = std::fclose(file) == 0 && ok;
+    return ok && replaceFile(tmp, filename);
+}
+
+template <typename Queue>
+bool BasicToDoList<Queue>::loadSnapshot(const std::string& filename) {
+    SMARTTODO_TIME(Load);
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(filename) || file->size() < sizeof(SnapshotHeader)) return false;
+
+    SnapshotHeader h;
+    std::memcpy(&h, file->data(), sizeof(h));
+    if (std::memcmp(h.magic, kSnapshotMagic, sizeof(h.magic)) != 0) return false;
+    const bool legacy = h.version == 1 || h.version == 2;
+    if (!(h.version >= 3 && h.version <= kSnapshotVersion && h.recordSize == sizeof(TaskRecord)) &&
+        !(h.version == 2 && h.recordSize == sizeof(LegacyTaskRecord)) &&
+        !(h.version == 1 && h.recordSize == kLegacyRecordSizeV1)) {
+        return false;
+    }
+    const std::uint64_t size = file->size();
+    if (h.recordsOffset > size || h.taskCount > (size - h.recordsOffset) / h.recordSize ||
+        h.blobOffset < h.recordsOffset + h.taskCount * h.recordSize ||
+        h.blobOffset > size || h.blobSize > size - h.blobOffset) {
+        return false;
+    }
+    // the rule and edge tables: a count, then that many records
+    const char* tables = file->data() + h.blobOffset + h.blobSize;
+    auto table = [&](std::size_t recordSize, const char*& records, std::uint64_t& count) {
+        const std::uint64_t rest = size - static_cast<std::uint64_t>(tables - file->data());
+        if (rest < sizeof(count)) return false;
+        std::memcpy(&count, tables, sizeof(count));
+        records = tables + sizeof(count);
+        if (count > (rest - sizeof(count)) / recordSize) return false;
+        tables = records + count * recordSize;
+        return true;
+    };
+    std::uint64_t ruleCount = 0, edgeCount = 0;
+    const char* rules = nullptr;
+    const char* edges = nullptr;
+    if (h.version >= 4 && !table(sizeof(RuleRecord), rules, ruleCount)) return false;
+    if (h.version >= 5 && !table(sizeof(EdgeRecord), edges, edgeCount)) return false;
+
+    const char* recordBase = file->data() + h.recordsOffset;
+    const char* blob = file->data() + h.blobOffset;
+    // validate everything before touching the list
+    for (std::uint64_t i = 0; i < h.taskCount; ++i) {
+        const char* rec = recordBase + i * h.recordSize;
+        if (legacy) {
+            LegacyTaskRecord r{}; // a version 1 record is a prefix of this one, with id left 0
+            std::memcpy(&r, rec, h.recordSize);
+            std::uint64_t len = std::uint64_t{r.timestampLen} + r.dueDateLen + r.descLen;
+            if (r.blobOffset > h.blobSize || len > h.blobSize - r.blobOffset ||
+                r.descLen > kMaxDescLen) {
+                return false;
+            }
+            continue;
+        }
+        TaskRecord r;
+        std::memcpy(&r, rec, sizeof(r));
+        std::uint32_t prefix;
+        if (r.descOffset > h.blobSize || r.descLen > kMaxDescLen ||
+            std::uint64_t{r.descLen} + sizeof(prefix) > h.blobSize - r.descOffset) {
+            return false;
+        }
+        std::memcpy(&prefix, blob + r.descOffset, sizeof(prefix));
+        if (prefix != r.descLen) return false;
+    }
+
+    clearTasks();
+    ids_.reserve(h.taskCount);
+    created_.reserve(h.taskCount);
+    due_.reserve(h.taskCount);
+    descs_.reserve(h.taskCount);
+    queue_.reserve(h.taskCount);
+    for (std::uint64_t i = 0; i < h.taskCount; ++i) {
+        const char* rec = recordBase + i * h.recordSize;
+        if (legacy) {
+            LegacyTaskRecord r{};
+            std::memcpy(&r, rec, h.recordSize);
+            const char* p = blob + r.blobOffset;
+            std::string_view desc(p + r.timestampLen + r.dueDateLen, r.descLen);
+            appendSlot(r.id, r.priority, arena_.store(desc),
+                       parseDateTime(std::string_view(p, r.timestampLen)),
+                       static_cast<std::time_t>(r.dueTime));
+            continue;
+        }
+        TaskRecord r;
+        std::memcpy(&r, rec, sizeof(r));
+        appendSlot(r.id, r.priority, blob + r.descOffset, static_cast<std::time_t>(r.created),
+                   static_cast<std::time_t>(r.dueTime));
+    }
+    // version 3 descriptions are read from the mapping, which lives as long as they may
+    if (!legacy) arena_.adopt(std::move(file));
+
+    lsn_ = h.lastLsn;
+    nextId_ = std::max<TaskId>(1, h.nextId);
+    finishLoad();
+    for (std::uint64_t i = 0; i < ruleCount; ++i) {
+        RuleRecord r;
+        std::memcpy(&r, rules + i * sizeof(RuleRecord), sizeof(r));
+        auto rule = unpackRecurrence(r.recurrence);
+        if (rule && slotOf_.count(r.id)) rules_.emplace(r.id, *rule);
+    }
+    if (edgeCount) {
+        std::vector<Dependency> loaded(edgeCount);
+        std::memcpy(loaded.data(), edges, edgeCount * sizeof(EdgeRecord));
+        restoreDependencies(loaded);
+    }
+    if (journal_) checkpoint(); // a wholesale replacement is not journaled record by record
+    return true;
+}
+
+template bool BasicToDoList<HeapQueue>::saveSnapshot(const std::string&) const;
+template bool BasicToDoList<HeapQueue>::loadSnapshot(const std::string&);
+template std::string BasicToDoList<HeapQueue>::encodeSnapshot(const FrozenList&);
+template bool BasicToDoList<HeapQueue>::writeSnapshot(const std::string&, const std::string&);
+template bool BasicToDoList<PriorityBuckets>::saveSnapshot(const std::string&) const;
+template bool BasicToDoList<PriorityBuckets>::loadSnapshot(const std::string&);
+template std::string BasicToDoList<PriorityBuckets>::encodeSnapshot(const FrozenList&);
+template bool BasicToDoList<PriorityBuckets>::writeSnapshot(const std::string&, const std::string&);
+
+} // namespace smarttodo
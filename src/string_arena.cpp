@@ -0,0 +1,88 @@
+#include "../include/string_arena.h"
+
+#include <stdexcept>
+
+namespace smarttodo {
+
+// Size classes: multiples of 16 bytes up to 256, then powers of two up to kLargeBytes.
+namespace {
+const std::size_t kSmallStep = 16;
+const std::size_t kSmallLimit = 256;
+const std::size_t kSmallClasses = kSmallLimit / kSmallStep; // classes 0..15
+} // namespace
+
+std::size_t StringArena::sizeClass(std::size_t bytes) {
+    if (bytes <= kSmallLimit) return (bytes + kSmallStep - 1) / kSmallStep - 1;
+    std::size_t cls = kSmallClasses;
+    for (std::size_t size = kSmallLimit * 2; size < bytes; size *= 2) ++cls;
+    return cls;
+}
+
+std::size_t StringArena::classBytes(std::size_t cls) {
+    if (cls < kSmallClasses) return (cls + 1) * kSmallStep;
+    return kSmallLimit << (cls - kSmallClasses + 1);
+}
+
+const char* StringArena::store(std::string_view s) {
+    if (s.size() >= kOwnedBit) throw std::length_error("description too long");
+    const std::size_t bytes = sizeof(std::uint32_t) + s.size();
+    char* p;
+    if (bytes > kLargeBytes) {
+        std::unique_ptr<char[]> block(new char[bytes]);
+        p = block.get();
+        large_.emplace(p, std::move(block));
+        reserved_ += bytes;
+    } else {
+        const std::size_t cls = sizeClass(bytes);
+        if (cls >= freeLists_.size()) freeLists_.resize(cls + 1);
+        auto& freeList = freeLists_[cls];
+        if (!freeList.empty()) {
+            p = freeList.back();
+            freeList.pop_back();
+        } else {
+            const std::size_t size = classBytes(cls);
+            if (remaining_ < size) {
+                chunks_.emplace_back(new char[kChunkBytes]);
+                cursor_ = chunks_.back().get();
+                remaining_ = kChunkBytes;
+                reserved_ += kChunkBytes;
+            }
+            p = cursor_;
+            cursor_ += size;
+            remaining_ -= size;
+        }
+    }
+    std::uint32_t len = static_cast<std::uint32_t>(s.size()) | kOwnedBit;
+    std::memcpy(p, &len, sizeof(len));
+    std::memcpy(p + sizeof(len), s.data(), s.size());
+    return p;
+}
+
+void StringArena::release(const char* p) {
+    std::uint32_t len;
+    std::memcpy(&len, p, sizeof(len));
+    if (!(len & kOwnedBit)) return; // lives in an adopted region
+    const std::size_t bytes = sizeof(len) + (len & ~kOwnedBit);
+    if (bytes > kLargeBytes) {
+        large_.erase(p);
+        reserved_ -= bytes;
+        return;
+    }
+    freeLists_[sizeClass(bytes)].push_back(const_cast<char*>(p));
+}
+
+void StringArena::adopt(std::shared_ptr<const void> region) {
+    adopted_.push_back(std::move(region));
+}
+
+void StringArena::clear() {
+    chunks_.clear();
+    large_.clear();
+    cursor_ = nullptr;
+    remaining_ = 0;
+    freeLists_.clear();
+    adopted_.clear();
+    reserved_ = 0;
+}
+
+} // namespace smarttodo
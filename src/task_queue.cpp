@@ -0,0 +1,128 @@
+#include "../include/task_queue.h"
+
+namespace smarttodo {
+
+void HeapQueue::push(std::uint32_t slot, int priority) {
+    append(slot, priority);
+    siftUp(heap_.size() - 1);
+}
+
+// Moves the last node into the hole and lets it sift whichever way restores the heap.
+void HeapQueue::erase(std::uint32_t slot) {
+    const std::size_t pos = pos_[slot];
+    Node last = heap_.back();
+    heap_.pop_back();
+    if (pos < heap_.size()) {
+        place(pos, last);
+        siftUp(pos);
+        siftDown(pos_[last.slot]);
+    }
+}
+
+void HeapQueue::update(std::uint32_t slot, int priority) {
+    const std::size_t pos = pos_[slot];
+    const int old = heap_[pos].priority;
+    heap_.modify(pos).priority = priority;
+    if (priority < old) siftUp(pos);
+    else siftDown(pos);
+}
+
+void HeapQueue::append(std::uint32_t slot, int priority) {
+    track(slot);
+    pos_[slot] = static_cast<std::uint32_t>(heap_.size());
+    heap_.push_back(Node{priority, slot});
+}
+
+void HeapQueue::restore() {
+    bool isHeap = true;
+    for (std::size_t i = 1; i < heap_.size() && isHeap; ++i) {
+        isHeap = !(heap_[i].priority < heap_[(i - 1) / kArity].priority);
+    }
+    if (!isHeap) heapify();
+}
+
+void HeapQueue::clear() {
+    heap_.clear();
+    pos_.clear();
+}
+
+void HeapQueue::reserve(std::size_t n) {
+    heap_.reserve(n);
+    pos_.reserve(n);
+}
+
+std::size_t HeapQueue::memoryUsage() const {
+    return heap_.capacity() * sizeof(Node) + pos_.capacity() * sizeof(std::uint32_t);
+}
+
+// pos_ is indexed by slot and grows as the list hands out new slots.
+void HeapQueue::track(std::uint32_t slot) {
+    if (slot >= pos_.size()) pos_.resize(slot + 1);
+}
+
+void HeapQueue::place(std::size_t pos, Node node) {
+    heap_.set(pos, node);
+    pos_[node.slot] = static_cast<std::uint32_t>(pos);
+}
+
+// heap order: lower priority value = more urgent = closer to the root
+void HeapQueue::siftUp(std::size_t pos) {
+    Node node = heap_[pos];
+    while (pos > 0) {
+        std::size_t parent = (pos - 1) / kArity;
+        if (!(node.priority < heap_[parent].priority)) break;
+        place(pos, heap_[parent]);
+        pos = parent;
+    }
+    place(pos, node);
+}
+
+void HeapQueue::siftDown(std::size_t pos) {
+    const std::size_t n = heap_.size();
+    Node node = heap_[pos];
+    for (;;) {
+        std::size_t first = pos * kArity + 1;
+        if (first >= n) break;
+        std::size_t best = first;
+        std::size_t last = std::min(first + kArity, n);
+        for (std::size_t c = first + 1; c < last; ++c) {
+            if (heap_[c].priority < heap_[best].priority) best = c;
+        }
+        if (!(heap_[best].priority < node.priority)) break;
+        place(pos, heap_[best]);
+        pos = best;
+    }
+    place(pos, node);
+}
+
+// Floyd's bottom-up construction: O(n), against O(n log n) for n pushes.
+void HeapQueue::heapify() {
+    if (heap_.size() < 2) return;
+    for (std::size_t i = (heap_.size() - 2) / kArity + 1; i-- > 0;) siftDown(i);
+}
+
+HeapQueue::Walk::Walk(const HeapQueue& queue) : queue_(&queue) {
+    if (!queue.heap_.empty()) frontier_.push_back(0);
+}
+
+bool HeapQueue::Walk::later(std::uint32_t a, std::uint32_t b) const {
+    const auto& heap = queue_->heap_;
+    return heap[a].priority != heap[b].priority ? heap[a].priority > heap[b].priority : a > b;
+}
+
+// A heap node is never more urgent than its parent, so once a node is yielded its
+// children are the only new candidates.
+void HeapQueue::Walk::next() {
+    auto later = [this](std::uint32_t a, std::uint32_t b) { return this->later(a, b); };
+    std::uint32_t pos = frontier_.front();
+    std::pop_heap(frontier_.begin(), frontier_.end(), later);
+    frontier_.pop_back();
+    const std::size_t n = queue_->heap_.size();
+    const std::size_t first = pos * kArity + 1;
+    for (std::size_t c = first; c < std::min(first + kArity, n); ++c) {
+        frontier_.push_back(static_cast<std::uint32_t>(c));
+        std::push_heap(frontier_.begin(), frontier_.end(), later);
+    }
+}
+
+} // namespace smarttodo
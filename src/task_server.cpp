@@ -0,0 +1,335 @@
+#include "../include/task_server.h"
+#include "../include/batch.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define SMARTTODO_HAVE_UNIX_SOCKETS 1
+#endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define SMARTTODO_HAVE_EPOLL 1
+#endif
+
+namespace smarttodo {
+
+namespace {
+
+const std::size_t kReadChunk = 64 * 1024;
+// A connection whose unsent responses pass this stops being read until they drain.
+const std::size_t kMaxPendingOutput = 4 * 1024 * 1024;
+// Longest request line accepted; a client sending more is disconnected.
+const std::size_t kMaxRequest = 1024 * 1024;
+
+#ifdef SMARTTODO_HAVE_UNIX_SOCKETS
+bool socketAddress(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return true;
+}
+#endif
+
+void appendResponse(std::string& out, bool ok, std::string_view body) {
+    out += ok ? "OK " : "ERR ";
+    out += std::to_string(body.size());
+    out += '\n';
+    out.append(body.data(), body.size());
+}
+
+} // namespace
+
+TaskServer::TaskServer(std::size_t maxTasks) : list_(output_, maxTasks) {}
+
+TaskServer::~TaskServer() {
+#ifdef SMARTTODO_HAVE_EPOLL
+    for (auto& entry : connections_) ::close(entry.first);
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        ::unlink(socketPath_.c_str());
+    }
+    if (epollFd_ >= 0) ::close(epollFd_);
+    if (stopFd_ >= 0) ::close(stopFd_);
+#endif
+}
+
+bool TaskServer::listen(const std::string& path) {
+#ifdef SMARTTODO_HAVE_EPOLL
+    sockaddr_un addr;
+    if (listenFd_ >= 0 || !socketAddress(path, addr)) return false;
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    stopFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (epollFd_ < 0 || stopFd_ < 0 || fd < 0) {
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        return false;
+    }
+    listenFd_ = fd;
+    socketPath_ = path;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd_;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &ev);
+    ev.data.fd = stopFd_;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, stopFd_, &ev);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void TaskServer::stop() {
+#ifdef SMARTTODO_HAVE_EPOLL
+    std::uint64_t one = 1;
+    if (stopFd_ >= 0) (void)::write(stopFd_, &one, sizeof(one));
+#endif
+}
+
+bool TaskServer::serve() {
+#ifdef SMARTTODO_HAVE_EPOLL
+    if (listenFd_ < 0) return false;
+    epoll_event events[64];
+    for (;;) {
+        int n = ::epoll_wait(epollFd_, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        for (int i = 0; i < n; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == stopFd_) {
+                std::uint64_t count;
+                (void)::read(stopFd_, &count, sizeof(count));
+                return true;
+            }
+            if (fd == listenFd_) {
+                accept();
+                continue;
+            }
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) continue;
+            Connection& conn = it->second;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) onReadable(fd, conn);
+            if (!flush(fd, conn)) close(fd);
+        }
+    }
+#else
+    return false;
+#endif
+}
+
+void TaskServer::accept() {
+#ifdef SMARTTODO_HAVE_EPOLL
+    for (;;) {
+        int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // EAGAIN, or a client that already went away
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections_[fd];
+    }
+#endif
+}
+
+void TaskServer::onReadable(int fd, Connection& conn) {
+#ifdef SMARTTODO_HAVE_UNIX_SOCKETS
+    char buf[kReadChunk];
+    for (;;) {
+        ssize_t got = ::read(fd, buf, sizeof(buf));
+        if (got > 0) {
+            conn.in.append(buf, static_cast<std::size_t>(got));
+            if (static_cast<std::size_t>(got) < sizeof(buf)) break;
+            continue;
+        }
+        if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            conn.peerClosed = true;
+        }
+        if (got < 0 && errno == EINTR) continue;
+        break;
+    }
+    process(conn);
+#else
+    (void)fd;
+    (void)conn;
+#endif
+}
+
+// Runs every complete request in the input buffer, unless the connection already has
+// too much output waiting.
+void TaskServer::process(Connection& conn) {
+    std::size_t pos = 0;
+    std::string error;
+    while (conn.out.size() - conn.outPos < kMaxPendingOutput) {
+        std::size_t end = conn.in.find('\n', pos);
+        if (end == std::string::npos) break;
+        std::string_view line(conn.in.data() + pos, end - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        pos = end + 1;
+
+        output_.str(std::string());
+        if (runBatchCommand(list_, line, output_, error)) {
+            appendResponse(conn.out, true, output_.str());
+        } else {
+            appendResponse(conn.out, false, error);
+        }
+    }
+    conn.in.erase(0, pos);
+    if (conn.in.size() > kMaxRequest) conn.peerClosed = true;
+}
+
+bool TaskServer::flush(int fd, Connection& conn) {
+#ifdef SMARTTODO_HAVE_EPOLL
+    while (conn.outPos < conn.out.size()) {
+        ssize_t sent = ::send(fd, conn.out.data() + conn.outPos, conn.out.size() - conn.outPos, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        conn.outPos += static_cast<std::size_t>(sent);
+    }
+    if (conn.outPos == conn.out.size()) {
+        conn.out.clear();
+        conn.outPos = 0;
+        // requests held back while output was backlogged
+        if (conn.in.find('\n') != std::string::npos) {
+            process(conn);
+            if (!conn.out.empty()) return flush(fd, conn);
+        }
+        if (conn.peerClosed) return false;
+    }
+    const bool backlogged = conn.out.size() - conn.outPos >= kMaxPendingOutput;
+    epoll_event ev{};
+    ev.events = (backlogged || conn.peerClosed ? 0u : EPOLLIN) | (conn.out.empty() ? 0u : EPOLLOUT);
+    ev.data.fd = fd;
+    return ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+#else
+    (void)fd;
+    (void)conn;
+    return false;
+#endif
+}
+
+void TaskServer::close(int fd) {
+#ifdef SMARTTODO_HAVE_EPOLL
+    ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections_.erase(fd);
+#else
+    (void)fd;
+#endif
+}
+
+TaskClient::~TaskClient() {
+#ifdef SMARTTODO_HAVE_UNIX_SOCKETS
+    if (fd_ >= 0) ::close(fd_);
+#endif
+}
+
+bool TaskClient::connect(const std::string& path) {
+#ifdef SMARTTODO_HAVE_UNIX_SOCKETS
+    sockaddr_un addr;
+    if (fd_ >= 0 || !socketAddress(path, addr)) return false;
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool TaskClient::send(std::string_view command) {
+    if (fd_ < 0 || command.find('\n') != std::string_view::npos) return false;
+    out_.append(command.data(), command.size());
+    out_ += '\n';
+    ++inFlight_;
+    return out_.size() < kReadChunk || flush();
+}
+
+bool TaskClient::flush() {
+#ifdef SMARTTODO_HAVE_UNIX_SOCKETS
+    std::size_t pos = 0;
+    while (pos < out_.size()) {
+        ssize_t sent = ::send(fd_, out_.data() + pos, out_.size() - pos, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        pos += static_cast<std::size_t>(sent);
+    }
+    out_.clear();
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::optional<TaskClient::Response> TaskClient::receive() {
+#ifdef SMARTTODO_HAVE_UNIX_SOCKETS
+    if (fd_ < 0 || inFlight_ == 0 || !flush()) return std::nullopt;
+    Response response{false, std::string()};
+    std::size_t bodySize = 0;
+    std::size_t headerEnd = std::string::npos;
+    for (;;) {
+        if (headerEnd == std::string::npos) {
+            headerEnd = in_.find('\n', inPos_);
+            if (headerEnd != std::string::npos) {
+                std::string_view header(in_.data() + inPos_, headerEnd - inPos_);
+                response.ok = header.rfind("OK ", 0) == 0;
+                if (!response.ok && header.rfind("ERR ", 0) != 0) return std::nullopt;
+                bodySize = std::strtoull(header.data() + (response.ok ? 3 : 4), nullptr, 10);
+            }
+        }
+        if (headerEnd != std::string::npos && in_.size() - (headerEnd + 1) >= bodySize) {
+            response.body.assign(in_, headerEnd + 1, bodySize);
+            inPos_ = headerEnd + 1 + bodySize;
+            if (inPos_ * 2 >= in_.size()) { // drop what has been consumed once it dominates
+                in_.erase(0, inPos_);
+                inPos_ = 0;
+            }
+            --inFlight_;
+            return response;
+        }
+        char buf[kReadChunk];
+        ssize_t got = ::read(fd_, buf, sizeof(buf));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return std::nullopt;
+        in_.append(buf, static_cast<std::size_t>(got));
+    }
+#else
+    return std::nullopt;
+#endif
+}
+
+std::optional<TaskClient::Response> TaskClient::call(std::string_view command) {
+    if (!send(command)) return std::nullopt;
+    while (inFlight_ > 1) {
+        if (!receive()) return std::nullopt;
+    }
+    return receive();
+}
+
+} // namespace smarttodo
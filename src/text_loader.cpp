@@ -0,0 +1,159 @@
+#include "../include/todo.h"
+#include "../include/metrics.h"
+#include "datetime.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace smarttodo {
+
+// Parallel loader for the "priority|timestamp|due|description" text format, where a
+// recurring task's priority is followed by its rule ("2@1w"). The mapped file is cut
+// into newline-aligned chunks, each parsed on its own thread into columns whose
+// descriptions still point into the mapping; the chunks are then copied into the list
+// in file order and the queue ordered once.
+namespace {
+
+// Below this much input per thread, spawning threads costs more than it saves.
+const std::size_t kMinChunkBytes = 1 << 20;
+
+struct ChunkResult {
+    std::vector<int> priorities;
+    std::vector<std::time_t> created;
+    std::vector<std::time_t> due;
+    std::vector<std::string_view> descriptions;
+    std::vector<std::pair<std::size_t, Recurrence>> rules; // (index into the columns, rule)
+    std::size_t rejected = 0;
+};
+
+// Stores the first three '|' of [p, end) in `found`; returns how many there were.
+int findDelimiters(const char* p, const char* end, const char* found[3]) {
+    int n = 0;
+#if defined(__SSE2__)
+    const __m128i pipe = _mm_set1_epi8('|');
+    while (n < 3 && end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, pipe)));
+        while (mask && n < 3) {
+            found[n++] = p + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+#endif
+    for (; n < 3 && p < end; ++p) {
+        if (*p == '|') found[n++] = p;
+    }
+    return n;
+}
+
+// Accepts what std::stoi did: leading whitespace, an optional sign, trailing junk.
+bool parsePriority(const char* p, const char* end, int& value) {
+    while (p < end && std::isspace(static_cast<unsigned char>(*p))) ++p;
+    if (p < end && *p == '+') ++p;
+    auto result = std::from_chars(p, end, value);
+    return result.ec == std::errc();
+}
+
+void parseLine(const char* line, const char* end, ChunkResult& out) {
+    if (line == end) return; // blank lines are skipped without counting as malformed
+    const char* pipes[3];
+    int prio = 0;
+    if (findDelimiters(line, end, pipes) < 3 || !parsePriority(line, pipes[0], prio)) {
+        ++out.rejected;
+        return;
+    }
+    const std::time_t created = parseDateTime(std::string_view(pipes[0] + 1, pipes[1] - pipes[0] - 1));
+    std::time_t due = parseDateTime(std::string_view(pipes[1] + 1, pipes[2] - pipes[1] - 1));
+    // a rule that does not parse leaves a plain task, as a bad due date leaves none; a
+    // rule without a due date counts from the added time, as insertRecurring() does
+    const char* at = static_cast<const char*>(std::memchr(line, '@', pipes[0] - line));
+    if (at) {
+        if (auto rule = parseRecurrence(std::string_view(at + 1, pipes[0] - at - 1))) {
+            out.rules.emplace_back(out.priorities.size(), *rule);
+            if (due == kNoTime) due = created;
+        }
+    }
+    out.priorities.push_back(prio);
+    out.created.push_back(created);
+    out.due.push_back(due);
+    out.descriptions.emplace_back(pipes[2] + 1, end - pipes[2] - 1);
+}
+
+void parseChunk(const char* begin, const char* end, ChunkResult& out) {
+    while (begin < end) {
+        const char* nl = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        const char* lineEnd = nl ? nl : end;
+        parseLine(begin, lineEnd, out);
+        begin = lineEnd + 1;
+    }
+}
+
+} // namespace
+
+template <typename Queue>
+LoadStats BasicToDoList<Queue>::loadFromFile(const std::string& filename) {
+    SMARTTODO_TIME(Load);
+    LoadStats stats;
+    MappedFile file;
+    if (!file.open(filename)) return stats;
+    const char* data = file.data();
+    const char* end = data + file.size();
+
+    std::size_t threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    threads = std::max<std::size_t>(1, std::min(threads, file.size() / kMinChunkBytes));
+
+    // chunk i covers [bounds[i], bounds[i + 1]); every inner bound sits just past a '\n'
+    std::vector<const char*> bounds{data};
+    for (std::size_t i = 1; i < threads; ++i) {
+        const char* cut = std::max(bounds.back(), data + file.size() * i / threads);
+        const char* nl = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+        bounds.push_back(nl ? nl + 1 : end);
+    }
+    bounds.push_back(end);
+
+    std::vector<ChunkResult> chunks(threads);
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(parseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+    }
+    parseChunk(bounds[0], bounds[1], chunks[0]);
+    for (auto& w : workers) w.join();
+
+    std::size_t total = 0;
+    for (const auto& c : chunks) total += c.priorities.size();
+    clearTasks();
+    ids_.reserve(total);
+    created_.reserve(total);
+    due_.reserve(total);
+    descs_.reserve(total);
+    queue_.reserve(total);
+    std::vector<std::pair<std::uint32_t, Recurrence>> rules; // by slot until IDs are assigned
+    for (const auto& c : chunks) {
+        const std::uint32_t first = static_cast<std::uint32_t>(ids_.size());
+        for (std::size_t i = 0; i < c.priorities.size(); ++i) {
+            appendSlot(kNoTaskId, c.priorities[i], arena_.store(c.descriptions[i]), c.created[i],
+                       c.due[i]);
+        }
+        for (const auto& [i, rule] : c.rules) rules.emplace_back(first + static_cast<std::uint32_t>(i), rule);
+        stats.rejected += c.rejected;
+    }
+    stats.loaded = total;
+    finishLoad();
+    for (const auto& [slot, rule] : rules) rules_.emplace(ids_[slot], rule);
+    if (journal_) checkpoint(); // a wholesale replacement is not journaled record by record
+    return stats;
+}
+
+template LoadStats BasicToDoList<HeapQueue>::loadFromFile(const std::string&);
+template LoadStats BasicToDoList<PriorityBuckets>::loadFromFile(const std::string&);
+
+} // namespace smarttodo
@@ -1,186 +1,711 @@
 #include "../include/todo.h"
+#include "../include/metrics.h"
+#include "../include/reminder_scheduler.h"
+#include "datetime.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
 
 namespace smarttodo {
 
-static const int MAX_TASKS = 1000; // increased limit for flexibility
+static const int DUE_SOON_HOURS = 24;
 
-static std::string getCurrentDateTime() {
-    std::time_t now = std::time(nullptr);
-    std::tm* ltm = std::localtime(&now);
-    std::ostringstream ss;
-    ss << 1900 + ltm->tm_year << "-"
-       << std::setw(2) << std::setfill('0') << 1 + ltm->tm_mon << "-"
-       << std::setw(2) << std::setfill('0') << ltm->tm_mday << " "
-       << std::setw(2) << std::setfill('0') << ltm->tm_hour << ":"
-       << std::setw(2) << std::setfill('0') << ltm->tm_min;
-    return ss.str();
-}
-
-static bool parseDateTime(const std::string& dateStr, std::tm& dateTm) {
-    std::istringstream ss(dateStr);
-    ss >> std::get_time(&dateTm, "%Y-%m-%d %H:%M");
-    return !ss.fail();
-}
-
-static bool isOverdue(const std::string& dueDate) {
-    if (dueDate.empty()) return false;
-    std::tm dueTm = {};
-    if (!parseDateTime(dueDate, dueTm)) return false;
-    std::time_t now = std::time(nullptr);
-    std::time_t dueTime = std::mktime(&dueTm);
-    return std::difftime(now, dueTime) > 0;
+static bool isOverdue(std::time_t dueTime, std::time_t now) {
+    return dueTime != kNoTime && dueTime < now;
 }
 
-static bool isDueSoon(const std::string& dueDate, int hoursAhead = 24) {
-    if (dueDate.empty()) return false;
-    std::tm dueTm = {};
-    if (!parseDateTime(dueDate, dueTm)) return false;
-    std::time_t now = std::time(nullptr);
-    std::time_t dueTime = std::mktime(&dueTm);
-    double diffSeconds = std::difftime(dueTime, now);
-    return diffSeconds > 0 && diffSeconds <= hoursAhead * 3600;
+static bool isDueSoon(std::time_t dueTime, std::time_t now, int hoursAhead = DUE_SOON_HOURS) {
+    return dueTime != kNoTime && dueTime > now &&
+           dueTime - now <= static_cast<std::time_t>(hoursAhead) * 3600;
 }
 
-static void escapeCSV(std::string& s) {
-    size_t pos = 0;
-    while ((pos = s.find('"', pos)) != std::string::npos) {
-        s.replace(pos, 1, """"");
-        pos += 2;
+static std::string dueText(std::time_t dueTime) {
+    return dueTime == kNoTime ? "None" : formatDateTime(dueTime);
+}
+
+template <typename Queue>
+BasicToDoList<Queue>::BasicToDoList(std::ostream& out, std::size_t maxTasks) : out_(&out), maxTasks_(maxTasks) {}
+
+template <typename Queue>
+BasicToDoList<Queue>::~BasicToDoList() = default;
+template <typename Queue>
+BasicToDoList<Queue>::BasicToDoList(BasicToDoList&&) noexcept = default;
+template <typename Queue>
+BasicToDoList<Queue>& BasicToDoList<Queue>::operator=(BasicToDoList&&) noexcept = default;
+
+template <typename Queue>
+TaskId BasicToDoList<Queue>::insertTask(int priority, const std::string& desc, const std::string& dueDate) {
+    SMARTTODO_TIME(Insert);
+    if (size() >= maxTasks_) {
+        *out_ << "Task list full!" << std::endl;
+        return kNoTaskId;
     }
+
+    std::time_t created = currentMinute();
+    TaskId id = pushTask(priority, desc, created, parseDateTime(dueDate), kNoTaskId);
+    logInsert(slotOf_[id]);
+    *out_ << "Task added at " << formatDateTime(created) << " (ID " << id << ")" << std::endl;
+    return id;
+}
+
+template <typename Queue>
+TaskId BasicToDoList<Queue>::insertRecurring(int priority, const std::string& desc, const std::string& dueDate,
+                                             Recurrence every) {
+    SMARTTODO_TIME(Insert);
+    if (size() >= maxTasks_) {
+        *out_ << "Task list full!" << std::endl;
+        return kNoTaskId;
+    }
+
+    every.every = std::clamp<std::uint16_t>(every.every, 1, kMaxRecurrenceCount);
+    std::time_t created = currentMinute();
+    std::time_t dueTime = parseDateTime(dueDate);
+    TaskId id = pushTask(priority, desc, created, dueTime == kNoTime ? created : dueTime, kNoTaskId);
+    rules_.emplace(id, every);
+    logInsert(slotOf_[id]);
+    *out_ << "Recurring task added at " << formatDateTime(created) << " (ID " << id << ", every "
+          << formatRecurrence(every) << ")" << std::endl;
+    return id;
 }
 
-// comparator for min-heap by priority (lower value = higher priority)
-static bool taskCompare(const Task& a, const Task& b) {
-    return a.priority > b.priority; // std::push_heap expects max-heap comparator
+template <typename Queue>
+std::optional<Recurrence> BasicToDoList<Queue>::recurrence(TaskId id) const {
+    if (rules_.empty()) return std::nullopt;
+    auto it = rules_.find(id);
+    if (it == rules_.end()) return std::nullopt;
+    return it->second;
 }
 
-void ToDoList::insertTask(int priority, const std::string& desc, const std::string& dueDate) {
-    if (static_cast<int>(tasks_.size()) >= MAX_TASKS) {
-        std::cerr << "Task list full!" << std::endl;
+template <typename Queue>
+void BasicToDoList<Queue>::removeTask() {
+    SMARTTODO_TIME(Remove);
+    if (queue_.empty()) {
+        *out_ << "No tasks to remove!" << std::endl;
         return;
     }
 
-    Task t{priority, desc, getCurrentDateTime(), dueDate};
-    tasks_.push_back(t);
-    std::push_heap(tasks_.begin(), tasks_.end(), taskCompare);
-    std::cout << "Task added at " << t.timestamp << std::endl;
+    std::uint32_t slot = queue_.top();
+    const int priority = queue_.priority(slot);
+    const std::optional<Recurrence> rule = recurrence(ids_[slot]);
+    unlinkTask(slot);
+    logRemove(ids_[slot]);
+    *out_ << "Completed Task: " << StringArena::view(descs_[slot])
+          << " (Added: " << formatDateTime(created(slot)) << ")" << std::endl;
+    if (rule) queueNextOccurrence(priority, StringArena::view(descs_[slot]), due(slot), *rule);
+    releaseSlot(slot);
 }
 
-void ToDoList::removeTask() {
-    if (tasks_.empty()) {
-        std::cout << "No tasks to remove!" << std::endl;
-        return;
+// The first occurrence due after now, so a series completed late does not queue the
+// ones it missed; one with no due date counts from now. It takes the slot the completed
+// one is about to free at the latest, so the list never counts as full here.
+template <typename Queue>
+void BasicToDoList<Queue>::queueNextOccurrence(int priority, std::string_view desc, std::time_t lastDue,
+                                               Recurrence every) {
+    const std::time_t now = std::time(nullptr);
+    std::time_t next = lastDue == kNoTime ? now : lastDue;
+    do {
+        next = advanceTime(next, every);
+    } while (next != kNoTime && next <= now);
+    if (next == kNoTime) return; // past what time_t holds: the series ends
+
+    TaskId id = pushTask(priority, desc, currentMinute(), next, kNoTaskId);
+    rules_.emplace(id, every);
+    logInsert(slotOf_[id]);
+    *out_ << "Next occurrence due " << formatDateTime(next) << " (ID " << id << ")" << std::endl;
+}
+
+template <typename Queue>
+std::vector<TaskId> BasicToDoList<Queue>::insertTasks(const std::vector<NewTask>& tasks) {
+    const std::size_t room = size() < maxTasks_ ? maxTasks_ - size() : 0;
+    const std::size_t count = std::min(tasks.size(), room);
+    const std::time_t created = currentMinute();
+    const std::size_t first = queue_.size();
+    // on the heap k pushes cost O(k log n); appending and heapifying once costs
+    // O(n + k), which wins once the batch is about as large as the list
+    const bool rebuild = count >= first;
+    queue_.reserve(first + count);
+    std::vector<TaskId> ids;
+    ids.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const NewTask& t = tasks[i];
+        if (rebuild) {
+            std::uint32_t slot = storeTask(kNoTaskId, t.description, created, parseDateTime(t.dueDate));
+            queue_.append(slot, t.priority);
+            ids.push_back(ids_[slot]);
+        } else {
+            ids.push_back(pushTask(t.priority, t.description, created, parseDateTime(t.dueDate), kNoTaskId));
+        }
     }
+    if (rebuild) queue_.restore();
+    for (TaskId id : ids) logInsert(slotOf_[id]); // after restore, so a compaction sees an ordered queue
 
-    // top is tasks_.front() because we maintain heap
-    std::pop_heap(tasks_.begin(), tasks_.end(), taskCompare);
-    Task t = tasks_.back();
-    tasks_.pop_back();
-    std::cout << "Completed Task: " << t.description << " (Added: " << t.timestamp << ")" << std::endl;
+    *out_ << "Added " << count << " tasks";
+    if (count < tasks.size()) *out_ << " (" << tasks.size() - count << " skipped: task list full)";
+    *out_ << std::endl;
+    return ids;
 }
 
-void ToDoList::peekTask() const {
-    if (tasks_.empty()) {
-        std::cout << "No tasks available!" << std::endl;
+template <typename Queue>
+std::vector<Task> BasicToDoList<Queue>::completeTopK(std::size_t k) {
+    std::vector<Task> done;
+    done.reserve(std::min(k, queue_.size()));
+    // next occurrences are queued once the k are done, so none is completed twice
+    std::vector<std::pair<std::size_t, Recurrence>> recurring;
+    while (done.size() < k && !queue_.empty()) {
+        std::uint32_t slot = queue_.top();
+        const int priority = queue_.priority(slot);
+        if (auto rule = recurrence(ids_[slot])) recurring.emplace_back(done.size(), *rule);
+        unlinkTask(slot);
+        logRemove(ids_[slot]);
+        done.push_back(Task{ids_[slot], priority, std::string(StringArena::view(descs_[slot])),
+                            created(slot), due(slot)});
+        releaseSlot(slot);
+    }
+    *out_ << "Completed " << done.size() << " tasks" << std::endl;
+    for (const auto& [i, rule] : recurring) {
+        queueNextOccurrence(done[i].priority, done[i].description, done[i].dueTime, rule);
+    }
+    return done;
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::peekTask() const {
+    if (queue_.empty()) {
+        *out_ << "No tasks available!" << std::endl;
         return;
     }
-    const Task& t = tasks_.front();
-    std::cout << "Next Task: " << t.description << " (Priority " << t.priority << ", Added: " << t.timestamp << ", Due: " << (t.dueDate.empty() ? "None" : t.dueDate) << ")" << std::endl;
+    TaskView t = view(queue_.top());
+    *out_ << "Next Task: " << t.description << " (Priority " << t.priority << ", Added: " << formatDateTime(t.created) << ", Due: " << dueText(t.dueTime) << ")" << std::endl;
 }
 
-void ToDoList::displayTasks() const {
-    if (tasks_.empty()) {
-        std::cout << "No tasks available!" << std::endl;
+template <typename Queue>
+void BasicToDoList<Queue>::displayTasks(std::size_t offset, std::size_t limit) const {
+    SMARTTODO_TIME(Display);
+    if (queue_.empty()) {
+        *out_ << "No tasks available!" << std::endl;
         return;
     }
 
-    std::cout << "\nYour To-Do List (Heap View):\n";
-    std::cout << "---------------------------------------------------------------" << std::endl;
+    // rows are built in one buffer and written at once
+    std::string text = "\nYour To-Do List (Heap View):\n";
+    const std::string rule = "---------------------------------------------------------------\n";
+    text += rule;
+    std::time_t now = std::time(nullptr);
+    char stamp[kDateTimeLength];
+    std::size_t index = 0, shown = 0;
+    // ready tasks in priority order, then the ones waiting on others
+    auto row = [&](std::uint32_t slot) {
+        if (index++ < offset) return;
+        TaskView task = view(slot);
+        text += "ID: ";
+        text += std::to_string(task.id);
+        text += " | Priority: ";
+        text += std::to_string(task.priority);
+        text += " | Added: ";
+        text.append(stamp, formatDateTime(task.created, stamp));
+        text += " | Due: ";
+        if (task.dueTime == kNoTime) text += "None";
+        else text.append(stamp, formatDateTime(task.dueTime, stamp));
+        if (isOverdue(task.dueTime, now)) text += " (OVERDUE)";
+        else if (isDueSoon(task.dueTime, now)) text += " (Due Soon)";
+        if (auto rule = recurrence(task.id)) text += " | Repeats: every " + formatRecurrence(*rule);
+        if (isBlocked(slot)) {
+            text += " | Waits for:";
+            for (TaskId prerequisite : prerequisites(task.id)) text += " " + std::to_string(prerequisite);
+        }
+        text += " | Task: ";
+        text.append(task.description.data(), task.description.size());
+        text += '\n';
+        ++shown;
+    };
+    for (typename Queue::Walk walk(queue_); !walk.done() && shown < limit; walk.next()) row(walk.slot());
+    for (typename Queue::Walk walk(blocked_); !walk.done() && shown < limit; walk.next()) row(walk.slot());
+    text += rule;
+    if (shown < size()) {
+        text += shown ? "Showing " + std::to_string(offset + 1) + "-" + std::to_string(offset + shown)
+                      : std::string("Showing none");
+        text += " of " + std::to_string(size()) + " tasks\n";
+    }
+    *out_ << text << std::flush;
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::saveToFile(const std::string& filename) const {
+    SMARTTODO_TIME(Save);
+    std::ofstream file(filename);
+    if (!file) return;
+    // written in the queue's storage order, which loading it back reproduces; a recurring
+    // task's rule follows its priority ("2@1w"), which older versions read as priority 2
+    char stamp[kDateTimeLength];
+    forEachTask([&](std::uint32_t slot, int) {
+        TaskView t = view(slot);
+        file << t.priority;
+        if (auto rule = recurrence(t.id)) file << '@' << formatRecurrence(*rule);
+        file << '|';
+        file.write(stamp, static_cast<std::streamsize>(formatDateTime(t.created, stamp)));
+        file << '|';
+        file.write(stamp, static_cast<std::streamsize>(formatDateTime(t.dueTime, stamp)));
+        file << '|' << t.description << '\n';
+    });
+}
 
-    // For display only, copy into temporary vector and sort by priority ascending
-    std::vector<Task> copy = tasks_;
-    std::sort(copy.begin(), copy.end(), [](const Task& a, const Task& b){ return a.priority < b.priority; });
+template <typename Queue>
+void BasicToDoList<Queue>::exportToCSV(const std::string& filename) const {
+    if (!exportTasks(filename, ExportFormat::Csv)) {
+        std::cerr << "Failed to write CSV" << std::endl;
+        return;
+    }
+    *out_ << "Tasks exported to " << filename << std::endl;
+}
 
-    for (const auto& task : copy) {
-        std::string status = "";
-        if (isOverdue(task.dueDate)) status = " (OVERDUE)";
-        else if (isDueSoon(task.dueDate)) status = " (Due Soon)";
+template <typename Queue>
+void BasicToDoList<Queue>::remindUrgentTasks() const {
+    // Both ranges are prefixes of the due index: overdue is [begin, now), due soon is
+    // [now, now + 24h], so this costs O(log n + k) rather than a scan of every task.
+    std::time_t now = std::time(nullptr);
+    auto overdueEnd = dueIndex_.lower_bound({now, 0});
+    auto soonEnd = dueIndex_.upper_bound(
+        {now + static_cast<std::time_t>(DUE_SOON_HOURS) * 3600, std::numeric_limits<std::uint32_t>::max()});
+    bool hasUrgent = false;
+    for (auto it = dueIndex_.begin(); it != overdueEnd; ++it) {
+        *out_ << "Overdue Task: " << StringArena::view(descs_[it->second]) << std::endl;
+        hasUrgent = true;
+    }
+    for (auto it = overdueEnd; it != soonEnd; ++it) {
+        if (!isDueSoon(it->first, now)) continue; // due exactly now is neither
+        *out_ << "Due Soon: " << StringArena::view(descs_[it->second]) << " due by "
+              << formatDateTime(it->first) << std::endl;
+        hasUrgent = true;
+    }
+    if (!hasUrgent) *out_ << "No urgent tasks at the moment." << std::endl;
+}
 
-        std::cout << "Priority: " << task.priority
-                  << " | Added: " << task.timestamp
-                  << " | Due: " << (task.dueDate.empty() ? "None" : task.dueDate)
-                  << status
-                  << " | Task: " << task.description << std::endl;
+template <typename Queue>
+void BasicToDoList<Queue>::attachReminders(ReminderScheduler* scheduler) {
+    if (reminders_) reminders_->clear();
+    reminders_ = scheduler;
+    if (!reminders_) return;
+    for (const auto& entry : dueIndex_) {
+        reminders_->schedule(ids_[entry.second], StringArena::view(descs_[entry.second]), entry.first);
     }
+}
 
-    std::cout << "---------------------------------------------------------------" << std::endl;
+template <typename Queue>
+std::vector<TaskView> BasicToDoList<Queue>::topK(std::size_t k) const {
+    std::vector<TaskView> top;
+    top.reserve(std::min(k, queue_.size()));
+    for (auto it = byPriority().begin(); top.size() < k && it != PriorityIterator(); ++it) {
+        top.push_back(*it);
+    }
+    return top;
 }
 
-void ToDoList::saveToFile(const std::string& filename) const {
-    std::ofstream file(filename);
-    if (!file) return;
-    // write linearized list (not a heap order guarantee)
-    for (const auto& t : tasks_) {
-        file << t.priority << "|" << t.timestamp << "|" << t.dueDate << "|" << t.description << "\n";
+template <typename Queue>
+typename BasicToDoList<Queue>::PriorityRange BasicToDoList<Queue>::byPriority() const { return PriorityRange(*this); }
+
+template <typename Queue>
+std::vector<TaskView> BasicToDoList<Queue>::search(std::string_view query, std::size_t limit) const {
+    std::vector<TaskView> found;
+    const std::vector<std::string> terms = SearchIndex::terms(query);
+    if (terms.empty() || limit == 0) return found;
+    auto matchesAll = [&terms](std::string_view text) {
+        return std::all_of(terms.begin(), terms.end(),
+                           [text](const std::string& term) { return SearchIndex::matches(text, term); });
+    };
+
+    if (auto candidates = searchIndex_.candidates(terms)) {
+        for (TaskId id : *candidates) {
+            auto it = slotOf_.find(id);
+            if (it == slotOf_.end()) continue; // removed since it was indexed
+            TaskView t = view(it->second);
+            if (matchesAll(t.description)) found.push_back(t);
+        }
+    } else {
+        forEachTask([&](std::uint32_t slot, int) {
+            TaskView t = view(slot);
+            if (matchesAll(t.description)) found.push_back(t);
+        });
     }
+
+    auto urgentFirst = [](const TaskView& a, const TaskView& b) {
+        return a.priority != b.priority ? a.priority < b.priority : a.id < b.id;
+    };
+    if (found.size() > limit) {
+        std::partial_sort(found.begin(), found.begin() + limit, found.end(), urgentFirst);
+        found.resize(limit);
+    } else {
+        std::sort(found.begin(), found.end(), urgentFirst);
+    }
+    return found;
 }
 
-void ToDoList::loadFromFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file) return;
-    tasks_.clear();
-    std::string line;
-    while (std::getline(file, line)) {
-        size_t pos1 = line.find('|');
-        size_t pos2 = line.find('|', pos1 + 1);
-        size_t pos3 = line.find('|', pos2 + 1);
-        if (pos1 == std::string::npos || pos2 == std::string::npos || pos3 == std::string::npos) continue;
-        int prio = 0;
-        try { prio = std::stoi(line.substr(0, pos1)); } catch(...) { continue; }
-        std::string ts = line.substr(pos1 + 1, pos2 - pos1 - 1);
-        std::string due = line.substr(pos2 + 1, pos3 - pos2 - 1);
-        std::string desc = line.substr(pos3 + 1);
-        Task t{prio, desc, ts, due};
-        tasks_.push_back(t);
-    }
-    if (!tasks_.empty()) std::make_heap(tasks_.begin(), tasks_.end(), taskCompare);
-}
-
-void ToDoList::exportToCSV(const std::string& filename) const {
-    std::ofstream file(filename);
-    if (!file) {
-        std::cerr << "Failed to write CSV" << std::endl;
+template <typename Queue>
+std::optional<TaskView> BasicToDoList<Queue>::get(TaskId id) const {
+    auto it = slotOf_.find(id);
+    if (it == slotOf_.end()) return std::nullopt;
+    return view(it->second);
+}
+
+template <typename Queue>
+bool BasicToDoList<Queue>::updatePriority(TaskId id, int priority) {
+    auto it = slotOf_.find(id);
+    if (it == slotOf_.end()) return false;
+    Queue& queue = isBlocked(it->second) ? blocked_ : queue_;
+    int old = queue.priority(it->second);
+    queue.update(it->second, priority);
+    priority = queue.priority(it->second); // as stored, should the queue clamp it
+    logUpdate(id, priority);
+    *out_ << "Task " << id << " priority changed from " << old << " to " << priority << std::endl;
+    return true;
+}
+
+template <typename Queue>
+bool BasicToDoList<Queue>::remove(TaskId id) {
+    SMARTTODO_TIME(Remove);
+    auto it = slotOf_.find(id);
+    if (it == slotOf_.end()) return false;
+    std::uint32_t slot = it->second;
+    unlinkTask(slot);
+    logRemove(id);
+    *out_ << "Deleted Task: " << StringArena::view(descs_[slot])
+          << " (Added: " << formatDateTime(created(slot)) << ")" << std::endl;
+    releaseSlot(slot);
+    return true;
+}
+
+template <typename Queue>
+std::size_t BasicToDoList<Queue>::memoryUsage() const {
+    // hash nodes hold the key, the value and a next pointer; tree nodes add three
+    // pointers and a color word to the value
+    const std::size_t hashNode = sizeof(void*) + sizeof(TaskId) + sizeof(std::uint32_t) + 4;
+    const std::size_t treeNode = 4 * sizeof(void*) + sizeof(std::pair<std::time_t, std::uint32_t>);
+    std::size_t links = links_.capacity() * sizeof(Links);
+    for (const Links& l : links_) links += (l.dependents.capacity() + l.prerequisites.capacity()) * sizeof(TaskId);
+    return ids_.capacity() * sizeof(TaskId) + created_.capacity() * sizeof(std::int64_t) +
+           due_.capacity() * sizeof(std::int64_t) + descs_.capacity() * sizeof(const char*) +
+           freeSlots_.capacity() * sizeof(std::uint32_t) + queue_.memoryUsage() +
+           slotOf_.bucket_count() * sizeof(void*) + slotOf_.size() * hashNode +
+           (dueIndex_.size() + createdIndex_.size()) * treeNode + arena_.bytesReserved() + searchIndex_.memoryUsage() +
+           rules_.bucket_count() * sizeof(void*) + rules_.size() * (sizeof(void*) + sizeof(TaskId) + sizeof(Recurrence)) +
+           blocked_.memoryUsage() + links;
+}
+
+template <typename Queue>
+TaskView BasicToDoList<Queue>::view(std::uint32_t slot) const {
+    return TaskView{ids_[slot], priorityOf(slot), StringArena::view(descs_[slot]),
+                    created(slot), due(slot)};
+}
+
+// Assigns an ID unless one is given (replay).
+template <typename Queue>
+TaskId BasicToDoList<Queue>::pushTask(int priority, std::string_view desc, std::time_t created,
+                          std::time_t dueTime, TaskId id) {
+    std::uint32_t slot = storeTask(id, desc, created, dueTime);
+    queue_.push(slot, priority);
+    return ids_[slot];
+}
+
+// Fills a free slot and indexes it; the caller queues it.
+template <typename Queue>
+std::uint32_t BasicToDoList<Queue>::storeTask(TaskId id, std::string_view desc, std::time_t created,
+                                  std::time_t dueTime) {
+    if (id == kNoTaskId) id = nextId_++;
+    else nextId_ = std::max(nextId_, id + 1);
+    const char* stored = arena_.store(desc);
+    std::uint32_t slot;
+    if (!freeSlots_.empty()) {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+        ids_.set(slot, id);
+        created_.set(slot, created);
+        due_.set(slot, dueTime);
+        descs_.set(slot, stored);
+    } else {
+        slot = static_cast<std::uint32_t>(ids_.size());
+        ids_.push_back(id);
+        created_.push_back(created);
+        due_.push_back(dueTime);
+        descs_.push_back(stored);
+    }
+    slotOf_[id] = slot;
+    createdIndex_.emplace(created, slot);
+    if (dueTime != kNoTime) {
+        dueIndex_.emplace(dueTime, slot);
+        if (reminders_) reminders_->schedule(id, desc, dueTime);
+    }
+    searchIndex_.add(id, desc);
+    return slot;
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::unlinkTask(std::uint32_t slot) {
+    slotOf_.erase(ids_[slot]);
+    if (!rules_.empty()) rules_.erase(ids_[slot]);
+    createdIndex_.erase({created(slot), slot});
+    if (due(slot) != kNoTime) {
+        dueIndex_.erase({due(slot), slot});
+        if (reminders_) reminders_->cancel(ids_[slot]);
+    }
+    if (slot >= links_.size()) {
+        queue_.erase(slot);
         return;
     }
-    file << "Priority,Added,Due Date,Description\n";
-    for (const auto& t : tasks_) {
-        std::string desc = t.description;
-        escapeCSV(desc);
-        file << t.priority << ",\"" << t.timestamp << "\",\"" << t.dueDate << "\",\"" << desc << "\"\n";
+    if (isBlocked(slot)) blocked_.erase(slot);
+    else queue_.erase(slot);
+    releaseDependents(slot);
+    links_[slot] = Links{};
+    links_[slot].order = nextOrder_++; // the next task here starts without edges
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::releaseSlot(std::uint32_t slot) {
+    if (!saving_.expired()) {
+        deferredFrees_.push_back(descs_[slot]); // a background save may still read it
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire); // the save's reads came first
+        for (const char* desc : deferredFrees_) arena_.release(desc);
+        deferredFrees_.clear();
+        arena_.release(descs_[slot]);
     }
-    std::cout << "Tasks exported to " << filename << std::endl;
+    descs_.set(slot, nullptr);
+    freeSlots_.push_back(slot);
+    searchIndex_.noteRemoved();
+    if (searchIndex_.needsRebuild()) rebuildSearchIndex();
 }
 
-void ToDoList::remindUrgentTasks() const {
-    bool hasUrgent = false;
-    for (const auto& t : tasks_) {
-        if (isOverdue(t.dueDate)) {
-            std::cout << "Overdue Task: " << t.description << std::endl;
-            hasUrgent = true;
-        } else if (isDueSoon(t.dueDate)) {
-            std::cout << "Due Soon: " << t.description << " due by " << t.dueDate << std::endl;
-            hasUrgent = true;
+template <typename Queue>
+void BasicToDoList<Queue>::clearTasks() {
+    // a background save may still be reading the descriptions about to be freed
+    if (journal_) journal_->waitForCompaction();
+    deferredFrees_.clear();
+    ids_.clear();
+    created_.clear();
+    due_.clear();
+    descs_.clear();
+    freeSlots_.clear();
+    arena_.clear();
+    queue_.clear();
+    blocked_.clear();
+    links_.clear();
+    nextOrder_ = 0;
+    slotOf_.clear();
+    dueIndex_.clear();
+    createdIndex_.clear();
+    searchIndex_.clear();
+    rules_.clear();
+    if (reminders_) reminders_->clear();
+}
+
+// Bulk loading: appends a task in the next slot and at the back of the queue without
+// ordering it; finishLoad() fixes everything up once all tasks are in.
+template <typename Queue>
+void BasicToDoList<Queue>::appendSlot(TaskId id, int priority, const char* desc, std::time_t created,
+                          std::time_t dueTime) {
+    std::uint32_t slot = static_cast<std::uint32_t>(ids_.size());
+    ids_.push_back(id);
+    created_.push_back(created);
+    due_.push_back(dueTime);
+    descs_.push_back(desc);
+    queue_.append(slot, priority);
+}
+
+// After appendSlot() filled the list: gives new tasks IDs, restores the queue order
+// (snapshots are stored in queue order, so usually it is only checked) and rebuilds
+// the ID, creation and due indexes.
+template <typename Queue>
+void BasicToDoList<Queue>::finishLoad() {
+    for (TaskId id : ids_) nextId_ = std::max(nextId_, id + 1);
+    slotOf_.reserve(ids_.size());
+    for (std::uint32_t slot = 0; slot < ids_.size(); ++slot) {
+        TaskId id = ids_[slot];
+        if (id == kNoTaskId || !slotOf_.emplace(id, slot).second) {
+            id = nextId_++; // new task, or a duplicate ID in a damaged file
+            ids_.set(slot, id);
+            slotOf_.emplace(id, slot);
+        }
+        createdIndex_.emplace(created(slot), slot);
+        if (due(slot) != kNoTime) {
+            dueIndex_.emplace(due(slot), slot);
+            if (reminders_) reminders_->schedule(id, StringArena::view(descs_[slot]), due(slot));
         }
     }
-    if (!hasUrgent) std::cout << "No urgent tasks at the moment." << std::endl;
+    queue_.restore();
+    rebuildSearchIndex();
+}
+
+// Drops the entries of removed tasks by indexing the live ones afresh.
+template <typename Queue>
+void BasicToDoList<Queue>::rebuildSearchIndex() {
+    searchIndex_.clear();
+    forEachTask([this](std::uint32_t slot, int) { searchIndex_.add(ids_[slot], StringArena::view(descs_[slot])); });
+}
+
+template <typename Queue>
+bool BasicToDoList<Queue>::openJournal(const std::string& snapshotPath, const std::string& journalPath,
+                           const JournalOptions& options) {
+    journal_.reset();
+    std::ifstream probe(snapshotPath);
+    bool haveSnapshot = static_cast<bool>(probe);
+    probe.close();
+    if (haveSnapshot && !loadSnapshot(snapshotPath)) return false;
+    snapshotPath_ = snapshotPath;
+
+    std::uint64_t lastLsn = Journal::recover(journalPath, [this](const JournalRecord& r) {
+        applyJournalRecord(r);
+    });
+    journal_ = std::make_unique<Journal>(journalPath, options);
+    if (!journal_->open(std::max(lastLsn, lsn_) + 1)) {
+        journal_.reset();
+        return false;
+    }
+    // contents imported some other way (e.g. tasks.txt) must reach the snapshot before
+    // journaled operations are layered on top of them
+    if (!haveSnapshot && size() && lastLsn == 0) return checkpoint();
+    return true;
+}
+
+template <typename Queue>
+bool BasicToDoList<Queue>::checkpoint() {
+    SMARTTODO_TIME(Save);
+    if (!journal_) return false;
+    journal_->waitForCompaction();
+    if (!writeSnapshot(encodeSnapshot(*freeze()), snapshotPath_)) return false;
+    return journal_->reset(lsn_ + 1);
+}
+
+template <typename Queue>
+bool BasicToDoList<Queue>::checkpointInBackground() {
+    if (!journal_) return false;
+    journal_->waitForCompaction(); // at most one save at a time
+    return startCompaction();
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::logInsert(std::uint32_t slot) {
+    if (!journal_) return;
+    JournalRecord r;
+    r.op = JournalRecord::Op::Insert;
+    r.id = ids_[slot];
+    if (auto rule = recurrence(r.id)) {
+        r.op = JournalRecord::Op::RecurringInsert;
+        r.recurrence = packRecurrence(*rule);
+    }
+    r.priority = priorityOf(slot);
+    r.created = created(slot);
+    r.dueTime = due(slot);
+    r.description = StringArena::view(descs_[slot]);
+    lsn_ = journal_->append(r);
+    maybeCompact();
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::logRemove(TaskId id) {
+    if (!journal_) return;
+    JournalRecord r;
+    r.op = JournalRecord::Op::Remove;
+    r.id = id;
+    lsn_ = journal_->append(r);
+    maybeCompact();
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::logUpdate(TaskId id, int priority) {
+    if (!journal_) return;
+    JournalRecord r;
+    r.op = JournalRecord::Op::Update;
+    r.id = id;
+    r.priority = priority;
+    lsn_ = journal_->append(r);
+    maybeCompact();
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::logDepend(TaskId task, TaskId prerequisite) {
+    if (!journal_) return;
+    JournalRecord r;
+    r.op = JournalRecord::Op::Depend;
+    r.id = task;
+    r.prerequisite = prerequisite;
+    lsn_ = journal_->append(r);
+    maybeCompact();
+}
+
+template <typename Queue>
+void BasicToDoList<Queue>::maybeCompact() {
+    if (journal_->needsCompaction()) startCompaction();
+}
+
+template <typename Queue>
+auto BasicToDoList<Queue>::freeze() const -> std::shared_ptr<const FrozenList> {
+    std::vector<Dependency> edges;
+    blocked_.forEach([&](std::uint32_t slot, int) {
+        for (TaskId prerequisite : links_[slot].prerequisites) edges.push_back(Dependency{ids_[slot], prerequisite});
+    });
+    return std::make_shared<const FrozenList>(FrozenList{
+        queue_.share(), blocked_.share(), ids_.share(), created_.share(), due_.share(), descs_.share(),
+        std::vector<std::pair<TaskId, Recurrence>>(rules_.begin(), rules_.end()), std::move(edges), lsn_,
+        nextId_});
+}
+
+// Freezes the list and leaves encoding and writing the snapshot to the journal's
+// compaction thread, so the caller pays only for the freeze.
+template <typename Queue>
+bool BasicToDoList<Queue>::startCompaction() {
+    std::shared_ptr<const FrozenList> frozen = freeze();
+    saving_ = frozen;
+    return journal_->compactAsync([frozen = std::move(frozen), path = snapshotPath_]() mutable {
+        bool ok = writeSnapshot(encodeSnapshot(*frozen), path);
+        frozen.reset(); // unpins the descriptions before the compaction counts as finished
+        return ok;
+    });
+}
+
+// Replay skips records the loaded snapshot already covers. Capacity is not enforced:
+// the journal only holds operations that were accepted the first time around.
+template <typename Queue>
+void BasicToDoList<Queue>::applyJournalRecord(const JournalRecord& r) {
+    if (r.lsn <= lsn_) return;
+    auto it = slotOf_.find(r.id);
+    switch (r.op) {
+        case JournalRecord::Op::LegacyInsert:
+        case JournalRecord::Op::Insert:
+            if (it == slotOf_.end()) {
+                std::time_t created =
+                    r.op == JournalRecord::Op::Insert ? r.created : parseDateTime(r.timestamp);
+                pushTask(r.priority, r.description, created, r.dueTime, r.id);
+            }
+            break;
+        case JournalRecord::Op::RecurringInsert:
+            if (it == slotOf_.end()) {
+                pushTask(r.priority, r.description, r.created, r.dueTime, r.id);
+                if (auto rule = unpackRecurrence(r.recurrence)) rules_.emplace(r.id, *rule);
+            }
+            break;
+        case JournalRecord::Op::Remove:
+            if (it != slotOf_.end()) {
+                const std::uint32_t slot = it->second; // unlinkTask() erases the entry
+                unlinkTask(slot);
+                releaseSlot(slot);
+            }
+            break;
+        case JournalRecord::Op::Update:
+            if (it != slotOf_.end()) (isBlocked(it->second) ? blocked_ : queue_).update(it->second, r.priority);
+            break;
+        case JournalRecord::Op::Depend:
+            if (it != slotOf_.end()) {
+                auto prerequisite = slotOf_.find(r.prerequisite);
+                if (prerequisite != slotOf_.end()) linkTasks(it->second, prerequisite->second);
+            }
+            break;
+    }
+    lsn_ = r.lsn;
 }
 
+template class BasicToDoList<HeapQueue>;
+template class BasicToDoList<PriorityBuckets>;
+
 } // namespace smarttodo
@@ -1,7 +1,34 @@
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
+#include "../include/batch.h"
+#include "../include/concurrent_todo.h"
+#include "../include/cow_vector.h"
+#include "../include/external_todo.h"
+#include "../include/list_manager.h"
+#include "../include/metrics.h"
+#include "../include/reminder_scheduler.h"
+#include "../include/task_server.h"
 #include "../include/todo.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 TEST_CASE("insert and peek and remove") {
     smarttodo::ToDoList list;
     list.insertTask(2, "Test task 1", "");
@@ -12,3 +39,1375 @@ TEST_CASE("insert and peek and remove") {
     list.removeTask();
     list.removeTask();
 }
+
+TEST_CASE("reminders use parsed due times") {
+    smarttodo::ToDoList list;
+    std::time_t now = std::time(nullptr);
+    char past[32], soon[32], later[32];
+    std::time_t t1 = now - 3600, t2 = now + 3 * 3600, t3 = now + 72 * 3600;
+    std::strftime(past, sizeof(past), "%Y-%m-%d %H:%M", std::localtime(&t1));
+    std::strftime(soon, sizeof(soon), "%Y-%m-%d %H:%M", std::localtime(&t2));
+    std::strftime(later, sizeof(later), "%Y-%m-%d %H:%M", std::localtime(&t3));
+
+    std::ostringstream captured;
+    std::streambuf* old = std::cout.rdbuf(captured.rdbuf());
+    list.insertTask(3, "Late task", past);
+    list.insertTask(2, "Soon task", soon);
+    list.insertTask(1, "Later task", later);
+    list.insertTask(4, "Undated task", "");
+    captured.str("");
+    list.remindUrgentTasks();
+    std::string out = captured.str();
+    list.removeTask(); // removes "Later task"
+    list.removeTask(); // removes "Soon task"
+    captured.str("");
+    list.remindUrgentTasks();
+    std::string afterRemove = captured.str();
+    std::cout.rdbuf(old);
+
+    REQUIRE(out.find("Overdue Task: Late task") != std::string::npos);
+    REQUIRE(out.find(std::string("Due Soon: Soon task due by ") + soon) != std::string::npos);
+    REQUIRE(out.find("Later task") == std::string::npos);
+    REQUIRE(out.find("Undated task") == std::string::npos);
+    REQUIRE(afterRemove.find("Soon task") == std::string::npos);
+    REQUIRE(afterRemove.find("Overdue Task: Late task") != std::string::npos);
+}
+
+TEST_CASE("output stream and capacity are configurable") {
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 2);
+    list.insertTask(1, "first", "");
+    list.insertTask(2, "second", "");
+    REQUIRE(list.insertTask(3, "over capacity", "") == smarttodo::kNoTaskId);
+    REQUIRE(list.insertRecurring(3, "over capacity", "", smarttodo::Recurrence{}) == smarttodo::kNoTaskId);
+    const std::size_t full = out.str().find("Task list full!"); // the list's stream, not stderr
+    REQUIRE(full != std::string::npos);
+    REQUIRE(out.str().find("Task list full!", full + 1) != std::string::npos);
+    list.peekTask();
+    REQUIRE(out.str().find("Next Task: first") != std::string::npos);
+    list.removeTask();
+    list.removeTask();
+    list.removeTask();
+    REQUIRE(out.str().find("No tasks to remove!") != std::string::npos);
+}
+
+TEST_CASE("binary snapshot round-trips in heap order") {
+    std::ostringstream out;
+    smarttodo::ToDoList list(out);
+    list.insertTask(3, "write | pipes \"and\" quotes", "2030-01-02 03:04");
+    list.insertTask(1, "urgent", "");
+    list.insertTask(2, "middle", "");
+    const std::string path = "test_snapshot.db";
+    REQUIRE(list.saveSnapshot(path));
+
+    std::ostringstream loadedOut;
+    smarttodo::ToDoList loaded(loadedOut);
+    REQUIRE(loaded.loadSnapshot(path));
+    loaded.removeTask();
+    loaded.removeTask();
+    loaded.removeTask();
+    loaded.removeTask();
+    std::string s = loadedOut.str();
+    REQUIRE(s.find("Completed Task: urgent") < s.find("Completed Task: middle"));
+    REQUIRE(s.find("Completed Task: middle") < s.find("Completed Task: write | pipes"));
+    REQUIRE(s.find("No tasks to remove!") != std::string::npos);
+
+    {
+        std::ofstream corrupt(path, std::ios::binary | std::ios::trunc);
+        corrupt << "not a snapshot";
+    }
+    REQUIRE_FALSE(loaded.loadSnapshot(path));
+    std::remove(path.c_str());
+}
+
+static std::size_t countOccurrences(const std::string& haystack, const std::string& needle) {
+    std::size_t n = 0;
+    for (auto pos = haystack.find(needle); pos != std::string::npos;
+         pos = haystack.find(needle, pos + needle.size())) {
+        ++n;
+    }
+    return n;
+}
+
+// Pops everything and returns the completion messages in order.
+static std::string drain(smarttodo::ToDoList& list, std::ostringstream& out, std::size_t n) {
+    out.str("");
+    for (std::size_t i = 0; i < n; ++i) list.removeTask();
+    return out.str();
+}
+
+TEST_CASE("journal replays operations on top of the snapshot") {
+    const std::string snap = "test_journal.db", wal = "test_journal.wal";
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    {
+        std::ostringstream out;
+        smarttodo::ToDoList list(out);
+        REQUIRE(list.openJournal(snap, wal));
+        list.insertTask(3, "three", "");
+        list.insertTask(1, "one", "2031-05-06 07:08");
+        list.insertTask(2, "two", "");
+        list.removeTask(); // "one"
+    } // no checkpoint: only the journal has these operations
+
+    {
+        std::ofstream torn(wal, std::ios::binary | std::ios::app);
+        torn << "\x07\x00\x00\x00garbage"; // half-written record from a crash
+    }
+    {
+        std::ostringstream out;
+        smarttodo::ToDoList list(out);
+        REQUIRE(list.openJournal(snap, wal));
+        list.insertTask(4, "four", ""); // must land after the truncated tail
+    }
+
+    std::ostringstream out;
+    smarttodo::ToDoList list(out);
+    REQUIRE(list.openJournal(snap, wal));
+    std::string s = drain(list, out, 4);
+    REQUIRE(countOccurrences(s, "Completed Task:") == 3);
+    REQUIRE(s.find("Completed Task: two") < s.find("Completed Task: three"));
+    REQUIRE(s.find("Completed Task: three") < s.find("Completed Task: four"));
+    REQUIRE(s.find("one") == std::string::npos);
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+}
+
+TEST_CASE("journal compacts into the snapshot in the background") {
+    const std::string snap = "test_compact.db", wal = "test_compact.wal";
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    smarttodo::JournalOptions options;
+    options.commitBytes = 64; // commit (and so grow the file) almost every operation
+    options.compactBytes = 512;
+    {
+        std::ostringstream out;
+        smarttodo::ToDoList list(out, 1000);
+        REQUIRE(list.openJournal(snap, wal, options));
+        for (int i = 0; i < 300; ++i) list.insertTask(1 + i % 5, "task " + std::to_string(i), "");
+        for (int i = 0; i < 100; ++i) list.removeTask();
+    }
+    REQUIRE(std::ifstream(snap).good());
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 1000);
+    REQUIRE(list.openJournal(snap, wal, options));
+    std::string s = drain(list, out, 201);
+    REQUIRE(countOccurrences(s, "Completed Task:") == 200);
+    REQUIRE(s.find("No tasks to remove!") != std::string::npos);
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    std::remove((wal + ".old").c_str());
+}
+
+TEST_CASE("journal rotation appends to a segment a failed compaction left behind") {
+    const std::string snap = "test_leftover.db", wal = "test_leftover.wal";
+    for (int written : {0, 2}) { // an empty current segment, then one with records to carry over
+        std::remove(snap.c_str());
+        std::remove(wal.c_str());
+        std::ofstream(wal + ".old").flush();
+        {
+            std::ostringstream out;
+            smarttodo::ToDoList list(out, 1000);
+            REQUIRE(list.openJournal(snap, wal));
+            for (int i = 0; i < written; ++i) list.insertTask(2, "before " + std::to_string(i), "");
+            REQUIRE(list.checkpointInBackground());
+            for (int i = 0; i < 5; ++i) list.insertTask(3, "after " + std::to_string(i), "");
+        }
+        std::ostringstream out;
+        smarttodo::ToDoList list(out, 1000);
+        REQUIRE(list.openJournal(snap, wal));
+        REQUIRE(list.size() == static_cast<std::size_t>(written + 5));
+    }
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    std::remove((wal + ".old").c_str());
+}
+
+TEST_CASE("text loader parses chunks in parallel and counts malformed lines") {
+    const std::string path = "test_parallel_load.txt";
+    const int lines = 60000; // ~3 MB, enough for several 1 MB chunks
+    {
+        std::ofstream file(path);
+        for (int i = 0; i < lines; ++i) {
+            if (i % 1000 == 7) file << "garbage line without delimiters\n";
+            if (i % 1000 == 9) file << "x|2024-01-01 10:00||bad priority\n";
+            if (i % 1000 == 11) file << "\n";
+            file << " " << 1 + i % 5 << "|2024-01-01 10:00||padded task description "
+                 << i << "\n";
+        }
+        file << "1|2024-01-01 10:00||last line without newline";
+    }
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 0);
+    smarttodo::LoadStats stats = list.loadFromFile(path);
+    REQUIRE(stats.loaded == static_cast<std::size_t>(lines) + 1);
+    REQUIRE(stats.rejected == 2 * (lines / 1000));
+
+    std::string s = drain(list, out, stats.loaded);
+    REQUIRE(countOccurrences(s, "Completed Task:") == stats.loaded);
+    auto lastOne = s.rfind("Completed Task: padded task description 59995 ");
+    auto firstFive = s.find("Completed Task: padded task description 4 ");
+    REQUIRE(lastOne < firstFive); // priority order across chunk boundaries
+    std::remove(path.c_str());
+}
+
+TEST_CASE("tasks are addressable by stable ID") {
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 1000);
+    std::vector<smarttodo::TaskId> ids;
+    for (int i = 0; i < 200; ++i) {
+        ids.push_back(list.insertTask(1 + (i * 7) % 5, "task " + std::to_string(i), ""));
+    }
+    REQUIRE(ids.front() != smarttodo::kNoTaskId);
+    REQUIRE(list.get(ids[42])->description == "task 42");
+    REQUIRE_FALSE(list.get(12345));
+
+    REQUIRE(list.updatePriority(ids[150], 0)); // now the most urgent
+    REQUIRE(list.remove(ids[42]));
+    REQUIRE_FALSE(list.remove(ids[42]));
+    REQUIRE_FALSE(list.get(ids[42]));
+    REQUIRE(list.get(ids[43])->description == "task 43");
+
+    std::string s = drain(list, out, 199);
+    REQUIRE(s.rfind("Completed Task: task 150 ", 0) == 0);
+    REQUIRE(s.find("task 42 ") == std::string::npos);
+    // every task completes exactly once, in non-decreasing priority order
+    std::map<std::size_t, int> priorityByPosition;
+    for (int i = 0; i < 200; ++i) {
+        if (i == 42 || i == 150) continue;
+        auto pos = s.find("Completed Task: task " + std::to_string(i) + " ");
+        REQUIRE(pos != std::string::npos);
+        priorityByPosition[pos] = 1 + (i * 7) % 5;
+    }
+    int lastPriority = 0;
+    for (const auto& entry : priorityByPosition) {
+        REQUIRE(entry.second >= lastPriority);
+        lastPriority = entry.second;
+    }
+}
+
+TEST_CASE("IDs survive snapshots and journal replay") {
+    const std::string snap = "test_ids.db", wal = "test_ids.wal";
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    smarttodo::TaskId a, b, c;
+    {
+        std::ostringstream out;
+        smarttodo::ToDoList list(out);
+        REQUIRE(list.openJournal(snap, wal));
+        a = list.insertTask(3, "a", "");
+        b = list.insertTask(2, "b", "");
+        REQUIRE(list.checkpoint()); // a and b in the snapshot...
+        c = list.insertTask(4, "c", "");
+        list.updatePriority(c, 1); // ...the rest only in the journal
+        list.remove(b);
+    }
+    std::ostringstream out;
+    smarttodo::ToDoList list(out);
+    REQUIRE(list.openJournal(snap, wal));
+    REQUIRE(list.get(a)->description == "a");
+    REQUIRE_FALSE(list.get(b));
+    REQUIRE(list.get(c)->priority == 1);
+    smarttodo::TaskId d = list.insertTask(5, "d", "");
+    REQUIRE(d > c); // IDs are never reused
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+}
+
+TEST_CASE("task storage reuses slots and reads snapshot descriptions in place") {
+    const std::string path = "test_storage.db";
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 1000);
+    const std::string big(100000, 'x'); // beyond the arena's size classes
+    smarttodo::TaskId a = list.insertTask(2, "short", "2030-01-02 03:04");
+    smarttodo::TaskId b = list.insertTask(1, big, "");
+    REQUIRE(list.remove(a));
+    smarttodo::TaskId c = list.insertTask(3, "reuses the freed slot", "");
+    REQUIRE(list.get(b)->description == big);
+    REQUIRE(list.get(c)->description == "reuses the freed slot");
+    REQUIRE(list.get(c)->dueTime == smarttodo::kNoTime);
+    REQUIRE(list.memoryUsage() > big.size());
+    REQUIRE(list.saveSnapshot(path));
+
+    smarttodo::ToDoList loaded(out, 1000);
+    REQUIRE(loaded.loadSnapshot(path));
+    REQUIRE(list.saveSnapshot(path)); // replacing the file must not disturb the loaded list
+    loaded.insertTask(4, "after load", "");
+    REQUIRE(loaded.get(b)->description == big);
+    REQUIRE(loaded.get(c)->description == "reuses the freed slot");
+    REQUIRE(loaded.get(b)->created == list.get(b)->created);
+    std::string s = drain(loaded, out, 3);
+    REQUIRE(s.find("Completed Task: " + big) < s.find("Completed Task: reuses the freed slot"));
+    REQUIRE(s.find("Completed Task: reuses the freed slot") < s.find("Completed Task: after load"));
+    std::remove(path.c_str());
+}
+
+TEST_CASE("bulk insert and complete print one summary line") {
+    const std::string snap = "test_bulk.db", wal = "test_bulk.wal";
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    std::vector<smarttodo::NewTask> batch;
+    for (int i = 0; i < 120; ++i) batch.push_back({1 + (i * 3) % 5, "bulk " + std::to_string(i), ""});
+    {
+        std::ostringstream out;
+        smarttodo::ToDoList list(out, 100);
+        REQUIRE(list.openJournal(snap, wal));
+        list.insertTask(0, "single", "");
+        std::vector<smarttodo::TaskId> ids = list.insertTasks(batch); // larger than the list: heapified
+        REQUIRE(ids.size() == 99);
+        REQUIRE(list.get(ids[5])->description == "bulk 5");
+        REQUIRE(out.str().find("Added 99 tasks (21 skipped: task list full)\n") != std::string::npos);
+        REQUIRE(countOccurrences(out.str(), "Task added") == 1);
+    }
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 100);
+    REQUIRE(list.openJournal(snap, wal));
+    REQUIRE(list.size() == 100);
+    out.str("");
+    std::vector<smarttodo::Task> done = list.completeTopK(30);
+    REQUIRE(out.str() == "Completed 30 tasks\n");
+    REQUIRE(done.size() == 30);
+    REQUIRE(done[0].description == "single");
+    for (std::size_t i = 1; i < done.size(); ++i) REQUIRE(done[i - 1].priority <= done[i].priority);
+    REQUIRE(list.insertTasks({{0, "small batch", ""}}).size() == 1); // pushed, not heapified
+    REQUIRE(list.completeTopK(1000).size() == 71);
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+}
+
+TEST_CASE("top-k and paged views walk the heap in priority order") {
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 1000);
+    for (int i = 0; i < 500; ++i) list.insertTask((i * 37) % 101, "task " + std::to_string(i), "");
+
+    std::vector<smarttodo::TaskView> top = list.topK(50);
+    REQUIRE(top.size() == 50);
+    int last = -1;
+    std::size_t walked = 0;
+    for (smarttodo::TaskView t : list.byPriority()) {
+        REQUIRE(t.priority >= last);
+        if (walked < top.size()) REQUIRE(t.id == top[walked].id);
+        last = t.priority;
+        ++walked;
+    }
+    REQUIRE(walked == 500);
+    REQUIRE(list.topK(1000).size() == 500);
+
+    out.str("");
+    list.displayTasks(40, 20);
+    std::string page = out.str();
+    REQUIRE(countOccurrences(page, "ID: ") == 20);
+    REQUIRE(page.find("ID: " + std::to_string(top[40].id) + " ") != std::string::npos);
+    REQUIRE(page.find("ID: " + std::to_string(top[39].id) + " ") == std::string::npos);
+    REQUIRE(page.find("Showing 41-60 of 500 tasks") != std::string::npos);
+    out.str("");
+    list.displayTasks();
+    REQUIRE(countOccurrences(out.str(), "ID: ") == 500);
+    REQUIRE(out.str().find("Showing") == std::string::npos);
+}
+
+TEST_CASE("search matches substrings of every term, ignoring case") {
+    const std::string path = "test_search.db";
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 5000);
+    smarttodo::TaskId invoice = list.insertTask(3, "Pay the ACME invoice", "");
+    smarttodo::TaskId urgent = list.insertTask(1, "Send invoice reminder to ACME", "");
+    list.insertTask(2, "Call the plumber", "");
+    for (int i = 0; i < 3000; ++i) list.insertTask(4, "filler task " + std::to_string(i), "");
+
+    std::vector<smarttodo::TaskView> found = list.search("acme INVOICE");
+    REQUIRE(found.size() == 2);
+    REQUIRE(found[0].id == urgent); // most urgent first
+    REQUIRE(found[1].id == invoice);
+    REQUIRE(list.search("invo").size() == 2);               // prefix
+    REQUIRE(list.search("lumb").size() == 1);               // inside a word
+    REQUIRE(list.search("acme plumber").empty());           // AND of terms
+    REQUIRE(list.search("to acme").size() == 1);            // short term checked on candidates
+    REQUIRE(list.search("PL").size() == 1);                 // no trigram: scans every task
+    REQUIRE(list.search("filler", 5).size() == 5);
+    REQUIRE(list.search("   ").empty());
+
+    REQUIRE(list.remove(urgent));
+    REQUIRE(list.search("invoice").size() == 1);
+    list.completeTopK(2000); // enough removals to trigger a rebuild of the index
+    REQUIRE(list.search("filler").size() == 1002);
+    REQUIRE(list.search("acme").empty()); // "Pay the ACME invoice" was completed too
+
+    REQUIRE(list.saveSnapshot(path));
+    smarttodo::ToDoList loaded(out, 5000);
+    REQUIRE(loaded.loadSnapshot(path));
+    REQUIRE(loaded.search("filler task 2999").size() == 1);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("concurrent list hands every task to exactly one consumer") {
+    smarttodo::ConcurrentToDoList exact(1);
+    exact.insertTask(3, "c", "");
+    exact.insertTask(1, "a", "");
+    exact.insertTask(2, "b", "");
+    exact.insertTask(1, "a2", "");
+    REQUIRE(exact.peekMin()->description == "a");
+    REQUIRE(exact.popMin()->description == "a");
+    REQUIRE(exact.popMin()->description == "a2"); // FIFO among equals within a shard
+    REQUIRE(exact.popMin()->description == "b");
+    REQUIRE(exact.popMin()->description == "c");
+    REQUIRE_FALSE(exact.popMin());
+
+    smarttodo::ConcurrentToDoList bounded(4, 2);
+    REQUIRE(bounded.insertTask(1, "x", "") != smarttodo::kNoTaskId);
+    REQUIRE(bounded.insertTask(1, "y", "") != smarttodo::kNoTaskId);
+    REQUIRE(bounded.insertTask(1, "z", "") == smarttodo::kNoTaskId);
+    REQUIRE(bounded.popMin());
+    REQUIRE(bounded.insertTask(1, "z", "") != smarttodo::kNoTaskId);
+
+    smarttodo::ConcurrentToDoList list(8);
+    const int producers = 4, consumers = 4, perProducer = 5000;
+    std::atomic<int> popped{0};
+    std::vector<std::vector<smarttodo::TaskId>> seen(consumers);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&list, p] {
+            for (int i = 0; i < perProducer; ++i) list.insertTask((i + p) % 7, "job", "");
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&, c] {
+            while (popped.load() < producers * perProducer) {
+                if (auto task = list.popMin()) {
+                    seen[c].push_back(task->id);
+                    ++popped;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::set<smarttodo::TaskId> ids;
+    for (const auto& v : seen) ids.insert(v.begin(), v.end());
+    REQUIRE(ids.size() == static_cast<std::size_t>(producers * perProducer));
+    REQUIRE(list.size() == 0);
+}
+
+TEST_CASE("reminder scheduler fires due-soon then overdue and follows the list") {
+    std::mutex mutex;
+    std::condition_variable fired;
+    std::vector<smarttodo::Reminder> got;
+    smarttodo::ReminderScheduler scheduler([&](const smarttodo::Reminder& r) {
+        std::lock_guard<std::mutex> lock(mutex);
+        got.push_back(r);
+        fired.notify_all();
+    }, std::chrono::seconds(1));
+
+    std::time_t now = std::time(nullptr);
+    scheduler.schedule(1, "soon", now + 2);
+    scheduler.schedule(2, "cancelled", now + 2);
+    scheduler.schedule(3, "already overdue", now - 60);
+    scheduler.cancel(2);
+    REQUIRE(scheduler.pending() == 1);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        REQUIRE(fired.wait_for(lock, std::chrono::seconds(10), [&] { return got.size() >= 2; }));
+    }
+    REQUIRE(got.size() == 2);
+    REQUIRE(got[0].kind == smarttodo::ReminderKind::DueSoon);
+    REQUIRE(got[1].kind == smarttodo::ReminderKind::Overdue);
+    REQUIRE(got[1].id == 1);
+    REQUIRE(got[1].description == "soon");
+    REQUIRE(scheduler.pending() == 0);
+
+    // attached to a list, it is updated on every insert and removal without rescanning
+    std::ostringstream out;
+    smarttodo::ToDoList list(out);
+    list.insertTask(1, "before attach", "2999-01-01 09:00");
+    list.attachReminders(&scheduler);
+    REQUIRE(scheduler.pending() == 1);
+    smarttodo::TaskId id = list.insertTask(2, "after attach", "2999-01-02 09:00");
+    list.insertTask(3, "no due date", "");
+    REQUIRE(scheduler.pending() == 2);
+    REQUIRE(list.remove(id));
+    list.removeTask();
+    REQUIRE(scheduler.pending() == 0);
+    list.attachReminders(nullptr);
+}
+
+TEST_CASE("batch scripts run commands in order and report bad lines") {
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 3);
+    std::istringstream script("# comment\n"
+                              "add 2 write report | 2999-01-01 09:00\n"
+                              "add 1 call | bob\n"
+                              "\n"
+                              "add 9 bad priority\n"
+                              "update 2 3\n"
+                              "search report\n"
+                              "delete 42\n"
+                              "frobnicate\n"
+                              "add 5 third\n"
+                              "add 5 fourth\n"
+                              "remove\n");
+    smarttodo::BatchStats stats = smarttodo::runBatch(list, script, out);
+    REQUIRE(stats.commands == 10);
+    REQUIRE(stats.failed == 4);
+    REQUIRE(list.size() == 2);
+    REQUIRE(list.get(1)->dueTime != smarttodo::kNoTime);
+    REQUIRE(list.get(2)->description == "call");
+    REQUIRE(list.get(2)->priority == 3);
+
+    const std::string text = out.str();
+    REQUIRE(text.find("Line 5: expected: add") != std::string::npos);
+    REQUIRE(text.find("ID: 1 | Priority: 2 | Task: write report") != std::string::npos);
+    REQUIRE(text.find("Line 8: no task with ID 42") != std::string::npos);
+    REQUIRE(text.find("Line 9: unknown command 'frobnicate'") != std::string::npos);
+    REQUIRE(text.find("Line 11: task list full") != std::string::npos);
+    REQUIRE(text.find("Completed Task: write report") != std::string::npos);
+    // output order follows the script
+    REQUIRE(text.find("Line 5") < text.find("ID: 1 |"));
+}
+
+TEST_CASE("task server answers pipelined requests in order") {
+    const std::string path = "test_tasks.sock";
+    smarttodo::TaskServer server(1000);
+    REQUIRE(server.listen(path));
+    std::thread loop([&] { server.serve(); });
+
+    smarttodo::TaskClient client;
+    REQUIRE(client.connect(path));
+    auto added = client.call("add 2 water plants");
+    REQUIRE(added);
+    REQUIRE(added->ok);
+    REQUIRE(added->body.find("(ID 1)") != std::string::npos);
+    auto missing = client.call("delete 99");
+    REQUIRE(missing);
+    REQUIRE(!missing->ok);
+    REQUIRE(missing->body == "no task with ID 99");
+
+    for (int i = 0; i < 500; ++i) REQUIRE(client.send("add 3 task " + std::to_string(i)));
+    REQUIRE(client.send("peek"));
+    for (int i = 0; i < 500; ++i) {
+        auto r = client.receive();
+        REQUIRE(r);
+        REQUIRE(r->body.find("(ID " + std::to_string(i + 2) + ")") != std::string::npos);
+    }
+    auto peek = client.receive();
+    REQUIRE(peek);
+    REQUIRE(peek->body.find("Next Task: water plants") == 0);
+    REQUIRE(client.inFlight() == 0);
+
+    // a second client sees the same list
+    smarttodo::TaskClient other;
+    REQUIRE(other.connect(path));
+    auto view = other.call("view 0 1");
+    REQUIRE(view);
+    REQUIRE(view->body.find("Showing 1-1 of 501 tasks") != std::string::npos);
+
+    server.stop();
+    loop.join();
+    REQUIRE(server.list().size() == 501);
+}
+
+TEST_CASE("due dates parse leniently and print in canonical form") {
+    std::ostringstream out;
+    smarttodo::ToDoList list(out);
+    smarttodo::TaskId canonical = list.insertTask(1, "a", "2030-01-05 09:07");
+    smarttodo::TaskId loose = list.insertTask(1, "b", " 2030-1-5 9:7:59");
+    smarttodo::TaskId dateOnly = list.insertTask(1, "c", "2030-01-05");
+    smarttodo::TaskId bad = list.insertTask(1, "d", "2030-01-05 24:00");
+    REQUIRE(list.get(canonical)->dueTime != smarttodo::kNoTime);
+    REQUIRE(list.get(loose)->dueTime == list.get(canonical)->dueTime);
+    REQUIRE(list.get(canonical)->dueTime - list.get(dateOnly)->dueTime == 9 * 3600 + 7 * 60);
+    REQUIRE(list.get(bad)->dueTime == smarttodo::kNoTime);
+
+    // the added time is the current minute, printed in local time
+    std::time_t now = std::time(nullptr);
+    char expected[32];
+    std::strftime(expected, sizeof(expected), "%Y-%m-%d %H:%M", std::localtime(&list.get(canonical)->created));
+    out.str("");
+    list.displayTasks();
+    REQUIRE(out.str().find(std::string("Added: ") + expected + " | Due: 2030-01-05 09:07") != std::string::npos);
+    REQUIRE(out.str().find("Due: 2030-01-05 00:00") != std::string::npos);
+    REQUIRE(list.get(canonical)->created <= now);
+    REQUIRE(list.get(canonical)->created % 60 == 0);
+}
+
+TEST_CASE("exports write CSV, NDJSON and columnar files") {
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 100000);
+    list.insertTask(2, "say \"hi\", then \\ leave\t", "2030-01-05 09:07");
+    list.insertTask(1, "first", "");
+    auto slurp = [](const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    REQUIRE(list.exportTasks("test_export.csv", smarttodo::ExportFormat::Csv));
+    std::string csv = slurp("test_export.csv");
+    REQUIRE(csv.find("Priority,Added,Due Date,Description\n1,\"") == 0);
+    REQUIRE(csv.find("\",\"2030-01-05 09:07\",\"say \"\"hi\"\", then \\ leave\t\"\n") != std::string::npos);
+
+    REQUIRE(list.exportTasks("test_export.ndjson", smarttodo::ExportFormat::Ndjson));
+    std::string json = slurp("test_export.ndjson");
+    REQUIRE(json.find("{\"id\":2,\"priority\":1,\"added\":\"") == 0);
+    REQUIRE(json.find("\"due\":null,\"description\":\"first\"}\n") != std::string::npos);
+    REQUIRE(json.find("\"due\":\"2030-01-05 09:07\",\"description\":\"say \\\"hi\\\", then \\\\ leave\\t\"}\n") !=
+            std::string::npos);
+
+    REQUIRE(list.exportTasks("test_export.col", smarttodo::ExportFormat::Columnar));
+    std::string col = slurp("test_export.col");
+    std::uint64_t count = 0, firstId = 0, descEnd[2] = {};
+    std::int32_t firstPriority = 0;
+    std::memcpy(&count, col.data() + 8, 8);
+    std::memcpy(&firstId, col.data() + 16, 8);
+    std::memcpy(&firstPriority, col.data() + 32, 4);
+    std::memcpy(descEnd, col.data() + 16 + 2 * 8 + 2 * 4 + 2 * 8 + 2 * 8, 16);
+    REQUIRE(col.compare(0, 8, "STDOCOL1") == 0);
+    REQUIRE(count == 2);
+    // columns are in storage order, not heap order
+    REQUIRE(firstId == 1);
+    REQUIRE(firstPriority == 2);
+    REQUIRE(descEnd[0] == 23);
+    REQUIRE(descEnd[1] == 28);
+    REQUIRE(col.substr(col.size() - 5) == "first");
+
+    // chunks formatted on several threads come out in the same order as on one
+    for (int i = 0; i < 70000; ++i) list.insertTask(i % 5 + 1, "bulk " + std::to_string(i), "");
+    REQUIRE(list.exportTasks("test_export.ndjson", smarttodo::ExportFormat::Ndjson, 1));
+    const std::string single = slurp("test_export.ndjson");
+    REQUIRE(list.exportTasks("test_export.ndjson", smarttodo::ExportFormat::Ndjson, 4));
+    REQUIRE(slurp("test_export.ndjson") == single);
+    REQUIRE(std::count(single.begin(), single.end(), '\n') == 70002);
+
+    std::remove("test_export.csv");
+    std::remove("test_export.ndjson");
+    std::remove("test_export.col");
+}
+
+TEST_CASE("metrics histogram buckets and per-thread counts") {
+    using smarttodo::metrics::Histogram;
+    for (std::uint64_t ns : {0ull, 7ull, 8ull, 1000ull, 123456789ull, ~0ull}) {
+        std::size_t b = Histogram::bucketOf(ns);
+        REQUIRE(b < Histogram::kBuckets);
+        REQUIRE(Histogram::lowerBound(b) <= ns);
+        REQUIRE(ns <= Histogram::upperBound(b));
+        REQUIRE(Histogram::upperBound(b) - Histogram::lowerBound(b) <= ns / 8);
+    }
+    Histogram h;
+    for (std::uint64_t ns = 1; ns <= 1000; ++ns) {
+        ++h.buckets[Histogram::bucketOf(ns)];
+        ++h.count;
+        h.maxNs = ns;
+    }
+    REQUIRE(h.quantile(0.5) >= 500);
+    REQUIRE(h.quantile(0.5) <= 500 + 500 / 8);
+    REQUIRE(h.quantile(1.0) == 1000);
+    REQUIRE(h.countAtMost(7) == 7);
+
+    using smarttodo::metrics::Op;
+    smarttodo::metrics::Snapshot before = smarttodo::metrics::snapshot();
+    std::ostringstream out;
+    smarttodo::ToDoList list(out);
+    std::thread worker([&] {
+        for (int i = 0; i < 10; ++i) list.insertTask(3, "task", "");
+    });
+    worker.join(); // the worker's counts outlive it
+    list.removeTask();
+    list.displayTasks();
+    smarttodo::metrics::Snapshot after = smarttodo::metrics::snapshot();
+    if (!smarttodo::metrics::kEnabled) {
+        REQUIRE(after[Op::Insert].count == 0);
+        return;
+    }
+    REQUIRE(after[Op::Insert].count - before[Op::Insert].count == 10);
+    REQUIRE(after[Op::Remove].count - before[Op::Remove].count == 1);
+    REQUIRE(after[Op::Display].count - before[Op::Display].count == 1);
+
+    std::ostringstream prom;
+    smarttodo::metrics::writePrometheus(prom, after);
+    const std::string text = prom.str();
+    REQUIRE(text.find("# TYPE smarttodo_operation_duration_seconds histogram") != std::string::npos);
+    REQUIRE(text.find("smarttodo_operation_duration_seconds_count{op=\"insert\"} " +
+                      std::to_string(after[Op::Insert].count) + "\n") != std::string::npos);
+    REQUIRE(text.find("smarttodo_operation_duration_seconds_bucket{op=\"remove\",le=\"+Inf\"}") !=
+            std::string::npos);
+
+    std::string error;
+    std::ostringstream table;
+    REQUIRE(smarttodo::runBatchCommand(list, "stats", table, error));
+    REQUIRE(table.str().find("insert") != std::string::npos);
+}
+
+TEST_CASE("background checkpoint saves the list as it was while it keeps changing") {
+    smarttodo::CowVector<int> column;
+    for (int i = 0; i < 3000; ++i) column.push_back(i);
+    smarttodo::CowVector<int> copy = column.share();
+    column.set(5, -1);
+    column.pop_back();
+    column.push_back(-2);
+    REQUIRE(copy[5] == 5);
+    REQUIRE(copy.back() == 2999);
+    REQUIRE(column[5] == -1);
+    REQUIRE(column.back() == -2);
+
+    const std::string snap = "test_background.db", wal = "test_background.wal";
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    {
+        std::ostringstream out;
+        smarttodo::ToDoList list(out, 5000);
+        REQUIRE(list.openJournal(snap, wal));
+        for (int i = 0; i < 2000; ++i) list.insertTask(1 + i % 5, "task " + std::to_string(i), "");
+        REQUIRE(list.checkpointInBackground());
+        // released descriptions must survive until the save has read them
+        for (int i = 0; i < 1000; ++i) list.removeTask();
+        for (int i = 0; i < 500; ++i) list.insertTask(1, "later " + std::to_string(i), "");
+        for (smarttodo::TaskId id = 1; id <= 2000; ++id) list.updatePriority(id, 5);
+    }
+    std::ostringstream out;
+    smarttodo::ToDoList saved(out, 5000);
+    REQUIRE(saved.loadSnapshot(snap));
+    REQUIRE(saved.size() == 2000);
+    for (smarttodo::TaskId id = 1; id <= 2000; ++id) {
+        auto task = saved.get(id);
+        REQUIRE(task);
+        REQUIRE(task->description == "task " + std::to_string(id - 1));
+        REQUIRE(task->priority == 1 + static_cast<int>((id - 1) % 5));
+    }
+
+    smarttodo::ToDoList replayed(out, 5000);
+    REQUIRE(replayed.openJournal(snap, wal));
+    REQUIRE(replayed.size() == 1500);
+    REQUIRE(replayed.search("later").size() == 500);
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    std::remove((wal + ".old").c_str());
+}
+
+TEST_CASE("list manager keeps a bounded set of lists resident and queries summaries") {
+    const std::string dir = "test_lists";
+    std::filesystem::remove_all(dir);
+    REQUIRE(smarttodo::ListManager::validName("team-a_1.x"));
+    REQUIRE_FALSE(smarttodo::ListManager::validName("../etc"));
+    REQUIRE_FALSE(smarttodo::ListManager::validName(".hidden"));
+    REQUIRE_FALSE(smarttodo::ListManager::validName(""));
+
+    std::ostringstream out;
+    smarttodo::ListManagerOptions options;
+    options.maxOpenLists = 2;
+    options.out = &out;
+    {
+        smarttodo::ListManager lists(dir, options);
+        REQUIRE(lists.open("bad/name") == nullptr);
+        lists.open("x")->insertTask(3, "x three", "");
+        lists.open("x")->insertTask(4, "x four", "");
+        lists.open("y")->insertTask(5, "y five", "");
+        lists.open("y")->insertTask(1, "y one", "");
+        auto pinned = lists.open("z");
+        pinned->insertTask(2, "z two", "");
+        REQUIRE(lists.residentCount() == 2); // x was evicted
+        REQUIRE(std::filesystem::exists(dir + "/x.sum"));
+
+        lists.open("w");
+        REQUIRE(lists.residentCount() == 2); // y went; z is pinned
+        REQUIRE_FALSE(lists.evict("z"));
+        REQUIRE(lists.names() == std::vector<std::string>{"w", "x", "y", "z"});
+
+        std::vector<smarttodo::ListTask> top = lists.topUrgent(3);
+        REQUIRE(top.size() == 3);
+        REQUIRE(top[0].description == "y one");
+        REQUIRE(top[1].description == "z two");
+        REQUIRE(top[1].list == "z");
+        REQUIRE(top[2].description == "x three");
+        REQUIRE(lists.totalTasks() == 5);
+
+        // evicted lists come back from disk
+        REQUIRE(lists.open("x")->size() == 2);
+        REQUIRE(lists.open("x")->get(2)->description == "x four");
+    }
+    {
+        options.memoryBudget = 1; // only the list just opened stays
+        smarttodo::ListManager lists(dir, options);
+        REQUIRE(lists.open("y")->size() == 2);
+        REQUIRE(lists.open("z")->size() == 1);
+        REQUIRE(lists.residentCount() == 1);
+        REQUIRE(lists.topUrgent(100).size() == 5);
+
+        std::istringstream script("add 1 orphan\nuse w\nadd 1 w one\ntop 2\n");
+        std::ostringstream result;
+        smarttodo::BatchStats stats = smarttodo::runBatch(lists, script, result);
+        REQUIRE(stats.failed == 1);
+        REQUIRE(result.str().find("List: w | ID: 1 | Priority: 1 | Task: w one") != std::string::npos);
+        REQUIRE(result.str().find("List: y | ID: 2 | Priority: 1 | Task: y one") != std::string::npos);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("bucket backend keeps equal priorities first in, first out") {
+    const std::string snap = "test_buckets.db", wal = "test_buckets.wal";
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    auto order = [](const smarttodo::BucketToDoList& list) {
+        std::string s;
+        for (const smarttodo::TaskView& t : list.topK(smarttodo::BucketToDoList::kAllTasks)) {
+            s += std::string(t.description) + " ";
+        }
+        return s;
+    };
+    const std::string expected = "t0 t3 t6 t9 t1 t4 t7 t10 t12 t2 t5 t8 t11 clamped ";
+    std::ostringstream out;
+    {
+        smarttodo::BucketToDoList list(out, 100);
+        REQUIRE(list.openJournal(snap, wal));
+        std::vector<smarttodo::TaskId> ids;
+        for (int i = 0; i < 12; ++i) ids.push_back(list.insertTask(1 + i % 3, "t" + std::to_string(i), ""));
+        smarttodo::TaskId clamped = list.insertTask(9, "clamped", "");
+        REQUIRE(list.get(clamped)->priority == smarttodo::kMaxPriority);
+        REQUIRE(list.updatePriority(ids[1], 1)); // to the back of priority 1
+        REQUIRE(list.updatePriority(ids[3], 1)); // unchanged: keeps its place
+        REQUIRE(list.checkpoint());
+        list.insertTask(2, "t12", ""); // only in the journal
+        REQUIRE(order(list) == expected);
+    }
+    smarttodo::BucketToDoList reopened(out, 100);
+    REQUIRE(reopened.openJournal(snap, wal));
+    REQUIRE(order(reopened) == expected);
+
+    std::vector<smarttodo::Task> done = reopened.completeTopK(3);
+    REQUIRE(done.size() == 3);
+    REQUIRE(done[0].description == "t0");
+    REQUIRE(done[2].description == "t6");
+    REQUIRE(reopened.size() == 11);
+
+    // the heap backend reads the same snapshot, in the same priority order
+    REQUIRE(reopened.checkpoint());
+    smarttodo::ToDoList heap(out, 100);
+    REQUIRE(heap.loadSnapshot(snap));
+    std::vector<smarttodo::TaskView> fromHeap = heap.topK(100);
+    std::vector<smarttodo::TaskView> fromBuckets = reopened.topK(100);
+    REQUIRE(fromHeap.size() == fromBuckets.size());
+    for (std::size_t i = 0; i < fromHeap.size(); ++i) REQUIRE(fromHeap[i].priority == fromBuckets[i].priority);
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+}
+
+TEST_CASE("queries match a full scan whichever index they use") {
+    const std::string path = "test_query.txt";
+    {
+        std::ofstream file(path);
+        for (int i = 0; i < 3000; ++i) {
+            // creation times spread over March, due dates over April for two tasks in three
+            char due[32] = "";
+            if (i % 3) std::snprintf(due, sizeof(due), "2024-04-%02d %02d:00", 1 + (i * 11) % 28, i % 24);
+            char line[96];
+            std::snprintf(line, sizeof(line), "%d|2024-03-%02d %02d:%02d|%s|task %d\n", 1 + (i * 7) % 5,
+                          1 + i % 28, i % 24, i % 60, due, i);
+            file << line;
+        }
+    }
+    auto check = [&](auto& list) {
+        REQUIRE(list.loadFromFile(path).loaded == 3000);
+        std::vector<smarttodo::TaskView> all = list.topK(list.size());
+        std::vector<std::time_t> created, due;
+        for (const auto& t : all) {
+            created.push_back(t.created);
+            if (t.dueTime != smarttodo::kNoTime) due.push_back(t.dueTime);
+        }
+        std::sort(created.begin(), created.end());
+        std::sort(due.begin(), due.end());
+        REQUIRE(due.size() == 2000);
+
+        std::vector<smarttodo::TaskQuery> queries(7);
+        queries[0].maxPriority = 2;
+        queries[0].dueMin = due[100];
+        queries[0].dueMax = due[300]; // "priority <= 2 and due this week"
+        queries[1].dueMax = due[500];
+        queries[1].createdMax = created[200]; // "overdue and added before X"
+        queries[2].minPriority = 3;
+        queries[2].maxPriority = 3;
+        queries[3].dueMin = smarttodo::kNoTime; // no due date
+        queries[3].createdMin = created[2900];
+        queries[4].createdMin = created[10];
+        queries[4].createdMax = created[10];
+        queries[5].maxPriority = 5;
+        queries[5].dueMin = due[1999] + 1; // nothing
+        // queries[6] is open: every task
+        for (const smarttodo::TaskQuery& q : queries) {
+            std::vector<smarttodo::TaskId> expected;
+            for (const auto& t : all) {
+                if (t.priority >= q.minPriority && t.priority <= q.maxPriority && t.dueTime >= q.dueMin &&
+                    t.dueTime <= q.dueMax && t.created >= q.createdMin && t.created <= q.createdMax) {
+                    expected.push_back(t.id);
+                }
+            }
+            std::vector<smarttodo::TaskView> found = list.query(q);
+            std::vector<smarttodo::TaskId> ids;
+            for (const auto& t : found) ids.push_back(t.id);
+            std::vector<smarttodo::TaskId> sortedIds = ids;
+            std::sort(sortedIds.begin(), sortedIds.end());
+            std::sort(expected.begin(), expected.end());
+            REQUIRE(sortedIds == expected);
+            REQUIRE(std::is_sorted(found.begin(), found.end(), [](const auto& a, const auto& b) {
+                return a.priority != b.priority ? a.priority < b.priority : a.id < b.id;
+            }));
+            // a limit keeps the most urgent matches, equally urgent ones in any choice
+            std::vector<smarttodo::TaskView> top = list.query(q, 7);
+            REQUIRE(top.size() == std::min<std::size_t>(7, found.size()));
+            for (std::size_t i = 0; i < top.size(); ++i) {
+                REQUIRE(top[i].priority == found[i].priority);
+                REQUIRE(std::binary_search(expected.begin(), expected.end(), top[i].id));
+            }
+        }
+        REQUIRE(queries[6].maxPriority == std::numeric_limits<int>::max());
+        REQUIRE(list.query(queries[6]).size() == 3000);
+    };
+    std::ostringstream out;
+    smarttodo::ToDoList heap(out, 5000);
+    check(heap);
+    smarttodo::BucketToDoList buckets(out, 5000);
+    check(buckets);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("recurring tasks queue one occurrence at a time and persist as rules") {
+    auto dueText = [](const smarttodo::BucketToDoList& list, smarttodo::TaskId id) {
+        std::time_t due = list.get(id)->dueTime;
+        char text[32];
+        std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M", std::localtime(&due));
+        return std::string(text);
+    };
+    REQUIRE(smarttodo::parseRecurrence("2w").has_value());
+    REQUIRE(smarttodo::formatRecurrence(*smarttodo::parseRecurrence("12m")) == "12m");
+    REQUIRE_FALSE(smarttodo::parseRecurrence("0d"));
+    REQUIRE_FALSE(smarttodo::parseRecurrence("3y"));
+    REQUIRE_FALSE(smarttodo::parseRecurrence("w"));
+
+    const std::string txt = "test_recurring.txt", snap = "test_recurring.db", wal = "test_recurring.wal";
+    const std::string copy = "test_recurring_copy.db";
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    std::ostringstream out;
+    smarttodo::TaskId rent, stretch;
+    {
+        smarttodo::BucketToDoList list(out, 100);
+        REQUIRE(list.openJournal(snap, wal)); // no snapshot yet: everything is replayed below
+        const smarttodo::Recurrence day = *smarttodo::parseRecurrence("1d");
+        const smarttodo::Recurrence week = *smarttodo::parseRecurrence("1w");
+        const smarttodo::Recurrence month = *smarttodo::parseRecurrence("1m");
+        smarttodo::TaskId weekly = list.insertRecurring(1, "water plants", "2099-01-05 09:00", week);
+        smarttodo::TaskId monthly = list.insertRecurring(2, "pay rent", "2099-01-31 08:00", month);
+        smarttodo::TaskId daily = list.insertRecurring(3, "stretch", "2020-01-01 07:30", day);
+        list.insertTask(4, "one-off", "");
+        REQUIRE(list.size() == 4);
+        REQUIRE(list.recurrence(weekly)->unit == smarttodo::Recurrence::Unit::Week);
+        REQUIRE_FALSE(list.recurrence(list.topK(4).back().id));
+
+        // completing an occurrence queues the next, at the same priority
+        list.removeTask();
+        REQUIRE(list.size() == 4);
+        REQUIRE_FALSE(list.get(weekly));
+        smarttodo::TaskView next = list.topK(1).front();
+        REQUIRE(next.description == "water plants");
+        REQUIRE(next.priority == 1);
+        REQUIRE(dueText(list, next.id) == "2099-01-12 09:00");
+        list.updatePriority(next.id, 5);
+        std::vector<smarttodo::Task> done = list.completeTopK(2); // rent, then the missed stretches
+        REQUIRE(done.size() == 2);
+        REQUIRE(list.size() == 4);
+        std::vector<smarttodo::TaskView> tasks = list.topK(4);
+        REQUIRE(tasks[0].description == "pay rent");
+        REQUIRE(dueText(list, tasks[0].id) == "2099-02-28 08:00"); // the 31st, clamped
+        REQUIRE(tasks[1].description == "stretch");
+        REQUIRE(tasks[1].dueTime > std::time(nullptr)); // missed days are skipped
+        REQUIRE(tasks[1].dueTime - std::time(nullptr) <= 86400);
+        REQUIRE(dueText(list, tasks[1].id).substr(11) == "07:30");
+        REQUIRE(tasks[3].description == "water plants");
+        REQUIRE(tasks[3].priority == 5);
+        REQUIRE(list.recurrence(monthly) == std::nullopt);
+        REQUIRE(list.recurrence(daily) == std::nullopt);
+
+        // rules survive the journal, snapshots and the text format, one line per rule
+        rent = tasks[0].id;
+        stretch = tasks[1].id;
+        REQUIRE(list.saveSnapshot(copy));
+        smarttodo::BucketToDoList fromSnapshot(out, 100);
+        REQUIRE(fromSnapshot.loadSnapshot(copy));
+        REQUIRE(fromSnapshot.size() == 4);
+        REQUIRE(fromSnapshot.recurrence(rent)->unit == smarttodo::Recurrence::Unit::Month);
+        REQUIRE(fromSnapshot.recurrence(stretch)->unit == smarttodo::Recurrence::Unit::Day);
+        REQUIRE(fromSnapshot.get(rent)->dueTime == tasks[0].dueTime);
+        list.saveToFile(txt);
+        std::ifstream file(txt);
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        REQUIRE(std::count(text.begin(), text.end(), '\n') == 4);
+        REQUIRE(text.find("2@1m|") != std::string::npos);
+        smarttodo::BucketToDoList fromText(out, 100);
+        REQUIRE(fromText.loadFromFile(txt).loaded == 4);
+        REQUIRE(fromText.topK(1).front().description == "pay rent");
+        REQUIRE(fromText.recurrence(fromText.topK(1).front().id)->unit == smarttodo::Recurrence::Unit::Month);
+
+        // a rule with no due date counts from the added time, and its series goes on
+        const std::string undated = "test_recurring_undated.txt";
+        std::ofstream(undated) << "2@1d|2024-01-01 10:00||water plants\n2@1d|junk|junk|stretch\n";
+        std::ostringstream series;
+        smarttodo::BucketToDoList fromUndated(series, 100);
+        REQUIRE(fromUndated.loadFromFile(undated).loaded == 2);
+        REQUIRE(fromUndated.topK(1).front().dueTime == fromUndated.topK(1).front().created);
+        fromUndated.removeTask();
+        fromUndated.removeTask();
+        REQUIRE(fromUndated.size() == 2);
+        const std::string completed = series.str();
+        REQUIRE(completed.find("Next occurrence due") != completed.rfind("Next occurrence due"));
+        std::remove(undated.c_str());
+
+        // deleting an occurrence ends its series
+        REQUIRE(list.remove(rent));
+        REQUIRE(list.size() == 3);
+    }
+    smarttodo::BucketToDoList replayed(out, 100);
+    REQUIRE(replayed.openJournal(snap, wal));
+    REQUIRE(replayed.size() == 3);
+    REQUIRE_FALSE(replayed.get(rent));
+    REQUIRE(replayed.recurrence(stretch)->unit == smarttodo::Recurrence::Unit::Day);
+    std::string error;
+    REQUIRE(smarttodo::runBatchCommand(replayed, "repeat 2w 3 standup | 2099-03-02 10:00", out, error));
+    REQUIRE(replayed.size() == 4);
+    REQUIRE_FALSE(smarttodo::runBatchCommand(replayed, "repeat 2y 3 standup", out, error));
+    replayed.displayTasks();
+    REQUIRE(out.str().find("Due: 2099-03-02 10:00 | Repeats: every 2w | Task: standup") != std::string::npos);
+    std::remove(txt.c_str());
+    std::remove(copy.c_str());
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+}
+
+TEST_CASE("CSV import reads exportToCSV output back and reports bad rows") {
+    const std::string csv = "test_import.csv", bad = "test_import_bad.csv";
+    std::ostringstream out;
+    smarttodo::ToDoList source(out, 100);
+    source.insertTask(2, "plain", "2099-01-02 03:04");
+    source.insertTask(1, "say \"hi\", then leave", "");
+    source.insertTask(3, "two\nlines", "2099-05-06 07:08");
+    source.exportToCSV(csv);
+
+    smarttodo::ToDoList imported(out, 100);
+    imported.insertTask(5, "already here", "");
+    smarttodo::ImportStats stats = imported.importFromCSV(csv);
+    REQUIRE(stats.imported == 3);
+    REQUIRE(stats.rejected == 0);
+    REQUIRE(imported.size() == 4);
+    std::vector<smarttodo::TaskView> want = source.topK(3), got = imported.topK(3);
+    for (std::size_t i = 0; i < want.size(); ++i) {
+        REQUIRE(got[i].priority == want[i].priority);
+        REQUIRE(got[i].description == want[i].description);
+        REQUIRE(got[i].created == want[i].created);
+        REQUIRE(got[i].dueTime == want[i].dueTime);
+    }
+
+    {
+        std::ofstream file(bad, std::ios::binary);
+        file << "Priority,Added,Due Date,Description\r\n"
+             << "1,,,crlf row\r\n"
+             << "\r\n"
+             << "x,,,not a priority\n"
+             << "2,,2099-13-40,bad due\n"
+             << "3,,,\"multi\nline\",extra\n"
+             << "4,,,\"closed\"junk\n"
+             << "5,,,\"kept, quoted\"\n"
+             << "6,,,one too many\n"
+             << "7,,,\"never closed\n";
+    }
+    smarttodo::ToDoList small(out, 2);
+    stats = small.importFromCSV(bad);
+    REQUIRE(stats.imported == 2);
+    REQUIRE(stats.rejected == 6);
+    REQUIRE(small.topK(2)[0].description == "crlf row");
+    REQUIRE(small.topK(2)[1].description == "kept, quoted");
+    REQUIRE(small.topK(2)[0].dueTime == smarttodo::kNoTime);
+    std::vector<std::pair<std::size_t, std::string>> errors;
+    for (const auto& e : stats.errors) errors.emplace_back(e.line, e.reason);
+    REQUIRE(errors == std::vector<std::pair<std::size_t, std::string>>{
+                          {4, "priority 'x' is not a number"},
+                          {5, "due date '2099-13-40' does not parse"},
+                          {6, "expected 4 fields, found 5"},
+                          {8, "text after a closing quote"},
+                          {11, "unterminated quoted field"},
+                          {10, "task list full"}, // rows are stored after the whole file is read
+                      });
+
+    std::string error;
+    REQUIRE_FALSE(smarttodo::runBatchCommand(small, "import missing_import.csv", out, error));
+    REQUIRE(error == "cannot read missing_import.csv");
+    std::remove(csv.c_str());
+    std::remove(bad.c_str());
+}
+
+TEST_CASE("dependencies hold tasks out of the queue until their prerequisites are done") {
+    const std::string snap = "test_depend.db", wal = "test_depend.wal", copy = "test_depend_copy.db";
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+    std::ostringstream out;
+    smarttodo::TaskId design, build, ship, other;
+    {
+        smarttodo::BucketToDoList list(out, 100);
+        REQUIRE(list.openJournal(snap, wal));
+        design = list.insertTask(3, "design", "");
+        build = list.insertTask(1, "build", "2099-01-01 09:00");
+        ship = list.insertTask(2, "ship it", "");
+        other = list.insertTask(5, "unrelated", "");
+        REQUIRE(list.addDependency(build, design));
+        REQUIRE(list.addDependency(ship, build));
+        REQUIRE(list.addDependency(ship, design));
+        REQUIRE_FALSE(list.addDependency(design, ship)); // a cycle
+        REQUIRE_FALSE(list.addDependency(design, design));
+        REQUIRE_FALSE(list.addDependency(build, design)); // already there
+        REQUIRE_FALSE(list.addDependency(build, 999));
+
+        // waiting tasks are kept but not suggested
+        REQUIRE(list.size() == 4);
+        REQUIRE(list.readyCount() == 2);
+        std::vector<smarttodo::TaskView> top = list.topK(4);
+        REQUIRE(top.size() == 2);
+        REQUIRE(top[0].id == design);
+        REQUIRE(top[1].id == other);
+        REQUIRE(list.query(smarttodo::TaskQuery()).size() == 2);
+        REQUIRE(list.query(smarttodo::TaskQuery{1, 1}).empty());
+        REQUIRE(list.search("ship").size() == 1);
+        REQUIRE(list.get(build)->priority == 1);
+        REQUIRE(list.updatePriority(ship, 4));
+        REQUIRE(list.get(ship)->priority == 4);
+        std::vector<smarttodo::TaskId> waits = list.prerequisites(ship);
+        std::sort(waits.begin(), waits.end());
+        REQUIRE(waits == std::vector<smarttodo::TaskId>{design, build});
+        REQUIRE(list.prerequisites(design).empty());
+        list.displayTasks();
+        REQUIRE(out.str().find("| Waits for: " + std::to_string(design) + " | Task: build") != std::string::npos);
+
+        // the edges survive a snapshot; the text format keeps the tasks only
+        REQUIRE(list.saveSnapshot(copy));
+        smarttodo::BucketToDoList fromSnapshot(out, 100);
+        REQUIRE(fromSnapshot.loadSnapshot(copy));
+        REQUIRE(fromSnapshot.size() == 4);
+        REQUIRE(fromSnapshot.readyCount() == 2);
+        REQUIRE(fromSnapshot.prerequisites(ship).size() == 2);
+        REQUIRE(fromSnapshot.get(ship)->priority == 4);
+
+        // completing a prerequisite releases whatever waits on nothing else
+        list.removeTask();
+        REQUIRE_FALSE(list.get(design));
+        REQUIRE(list.readyCount() == 2);
+        REQUIRE(list.topK(1).front().id == build);
+        REQUIRE(list.prerequisites(ship) == std::vector<smarttodo::TaskId>{build});
+        REQUIRE(list.remove(build)); // deleting one releases them too
+        REQUIRE(list.readyCount() == 2);
+        REQUIRE(list.prerequisites(ship).empty());
+        REQUIRE(list.topK(1).front().id == ship);
+        smarttodo::TaskId review = list.insertTask(1, "review", "");
+        std::string error;
+        REQUIRE(smarttodo::runBatchCommand(list, "depend " + std::to_string(review) + " " + std::to_string(ship),
+                                           out, error));
+        REQUIRE_FALSE(smarttodo::runBatchCommand(list, "depend " + std::to_string(ship) + " " +
+                                                           std::to_string(review), out, error));
+        REQUIRE_FALSE(smarttodo::runBatchCommand(list, "depend " + std::to_string(ship) + " 999", out, error));
+        REQUIRE(error == "no task with ID 999");
+    }
+    smarttodo::BucketToDoList replayed(out, 100);
+    REQUIRE(replayed.openJournal(snap, wal));
+    REQUIRE(replayed.size() == 3);
+    REQUIRE(replayed.readyCount() == 2);
+    REQUIRE(replayed.topK(3).front().id == ship);
+    REQUIRE(replayed.prerequisites(replayed.topK(3).front().id).empty());
+    std::remove(copy.c_str());
+    std::remove(snap.c_str());
+    std::remove(wal.c_str());
+}
+
+TEST_CASE("dependency cycle checks agree with a search and the queue drains in topological order") {
+    std::ostringstream out;
+    smarttodo::ToDoList list(out, 1000);
+    const int n = 300;
+    std::vector<smarttodo::TaskId> ids;
+    for (int i = 0; i < n; ++i) ids.push_back(list.insertTask(i % 7, "task " + std::to_string(i), ""));
+    std::vector<std::vector<int>> waitsFor(n);
+    auto reaches = [&](int from, int to) { // does `from` wait, directly or not, for `to`?
+        std::vector<char> seen(n, 0);
+        std::vector<int> stack{from};
+        while (!stack.empty()) {
+            int v = stack.back();
+            stack.pop_back();
+            if (v == to) return true;
+            for (int w : waitsFor[v]) {
+                if (!seen[w]) {
+                    seen[w] = 1;
+                    stack.push_back(w);
+                }
+            }
+        }
+        return false;
+    };
+    std::mt19937 rng(42);
+    std::size_t added = 0;
+    for (int e = 0; e < 1500; ++e) {
+        int task = static_cast<int>(rng() % n), prerequisite = static_cast<int>(rng() % n);
+        bool exists = std::find(waitsFor[task].begin(), waitsFor[task].end(), prerequisite) != waitsFor[task].end();
+        bool expect = task != prerequisite && !exists && !reaches(prerequisite, task);
+        REQUIRE(list.addDependency(ids[task], ids[prerequisite]) == expect);
+        if (expect) {
+            waitsFor[task].push_back(prerequisite);
+            ++added;
+        }
+    }
+    REQUIRE(added > 300);
+
+    // a snapshot lists edges in no particular order; loading relabels them
+    const std::string snap = "test_depend_dag.db";
+    REQUIRE(list.saveSnapshot(snap));
+    smarttodo::ToDoList loaded(out, 1000);
+    REQUIRE(loaded.loadSnapshot(snap));
+    std::remove(snap.c_str());
+    for (int i = 0; i < n; ++i) {
+        std::vector<smarttodo::TaskId> before = list.prerequisites(ids[i]), after = loaded.prerequisites(ids[i]);
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+        REQUIRE(before.size() == waitsFor[i].size());
+        REQUIRE(before == after);
+    }
+    for (int i = 0; i < n; ++i) {
+        // the relabelled order still rejects reversing any edge
+        for (int w : waitsFor[i]) REQUIRE_FALSE(loaded.addDependency(ids[w], ids[i]));
+    }
+
+    std::map<smarttodo::TaskId, int> index;
+    for (int i = 0; i < n; ++i) index[ids[i]] = i;
+    for (smarttodo::ToDoList* drained : {&list, &loaded}) {
+        std::set<smarttodo::TaskId> done;
+        while (drained->size()) {
+            REQUIRE(drained->readyCount() > 0);
+            smarttodo::TaskId next = drained->topK(1).front().id;
+            for (int w : waitsFor[index[next]]) REQUIRE(done.count(ids[w]));
+            drained->removeTask();
+            done.insert(next);
+        }
+        REQUIRE(done.size() == static_cast<std::size_t>(n));
+    }
+}
+
+TEST_CASE("out-of-core list serves tasks in order from sorted runs within its budget") {
+    const std::string dir = "test_external";
+    std::filesystem::remove_all(dir);
+    std::ostringstream out;
+    smarttodo::ExternalListOptions options;
+    options.memoryBudget = 64 * 1024;
+    options.maxRuns = 4;
+    options.out = &out;
+    // the model: (priority, ID) in the order tasks must leave, and each ID's description
+    std::set<std::pair<int, smarttodo::TaskId>> order;
+    std::map<smarttodo::TaskId, std::string> descs;
+    auto removeAndCheck = [&](smarttodo::ExternalToDoList& list) {
+        out.str("");
+        list.removeTask();
+        REQUIRE(out.str().rfind("Completed Task: " + descs[order.begin()->second] + " (", 0) == 0);
+        order.erase(order.begin());
+    };
+    auto shownIds = [&](const std::string& text) {
+        std::vector<smarttodo::TaskId> ids;
+        for (std::size_t at = text.find("ID: "); at != std::string::npos; at = text.find("ID: ", at + 1)) {
+            ids.push_back(std::stoull(text.substr(at + 4)));
+        }
+        return ids;
+    };
+
+    std::mt19937 rng(7);
+    {
+        smarttodo::ExternalToDoList list(dir, options);
+        REQUIRE(list.open());
+        for (int i = 0; i < 6000; ++i) {
+            const int priority = 1 + static_cast<int>(rng() % 5);
+            const std::string desc = "archived task " + std::to_string(i) + std::string(rng() % 40, 'x');
+            smarttodo::TaskId id = list.insertTask(priority, desc, i % 3 ? "" : "2030-01-01 09:00");
+            REQUIRE(id != smarttodo::kNoTaskId);
+            order.emplace(priority, id);
+            descs[id] = desc;
+            if (i % 5 == 0) removeAndCheck(list);
+        }
+        REQUIRE(list.size() == order.size());
+        REQUIRE(list.runCount() > 1);
+        REQUIRE(list.runCount() <= options.maxRuns);
+        REQUIRE(list.memoryUsage() <= options.memoryBudget);
+
+        out.str("");
+        list.displayTasks();
+        std::vector<smarttodo::TaskId> expected;
+        for (const auto& entry : order) expected.push_back(entry.second);
+        REQUIRE(shownIds(out.str()) == expected);
+        out.str("");
+        list.displayTasks(10, 5);
+        REQUIRE(shownIds(out.str()) == std::vector<smarttodo::TaskId>(expected.begin() + 10, expected.begin() + 15));
+        REQUIRE(out.str().find("Showing 11-15 of " + std::to_string(order.size()) + " tasks") != std::string::npos);
+
+        // both files read back into an in-memory list
+        REQUIRE(list.saveToFile(dir + "/saved.txt"));
+        list.exportToCSV(dir + "/saved.csv");
+        smarttodo::ToDoList text(out, 10000), csv(out, 10000);
+        REQUIRE(text.loadFromFile(dir + "/saved.txt").loaded == order.size());
+        REQUIRE(csv.importFromCSV(dir + "/saved.csv").imported == order.size());
+        REQUIRE(text.topK(1).front().description == descs[order.begin()->second]);
+
+        // reopening a list that holds tasks, flushed or not, keeps them
+        REQUIRE(list.flush());
+        REQUIRE(list.open());
+        REQUIRE(list.size() == order.size());
+        smarttodo::TaskId unflushed = list.insertTask(1, "before reopening", "");
+        order.emplace(1, unflushed);
+        descs[unflushed] = "before reopening";
+        REQUIRE(list.open());
+        REQUIRE(list.size() == order.size());
+        removeAndCheck(list);
+    }
+
+    // the manifest brings the runs back; run files it does not name are deleted
+    std::ofstream(dir + "/run-999.dat") << "left by a crash";
+    std::ofstream(dir + "/runs.manifest.tmp") << "left by a crash";
+    std::ofstream(dir + "/saved.csv.tmp") << "a user's file";
+    {
+        smarttodo::ExternalToDoList list(dir, options);
+        REQUIRE(list.open());
+        REQUIRE_FALSE(std::filesystem::exists(dir + "/run-999.dat"));
+        REQUIRE_FALSE(std::filesystem::exists(dir + "/runs.manifest.tmp"));
+        REQUIRE(std::filesystem::exists(dir + "/saved.csv.tmp"));
+        REQUIRE(list.size() == order.size());
+        smarttodo::TaskId id = list.insertTask(1, "after reopening", "");
+        REQUIRE(id > descs.rbegin()->first);
+        order.emplace(1, id);
+        descs[id] = "after reopening";
+        while (order.size() > 100) removeAndCheck(list);
+    }
+    {
+        smarttodo::ExternalToDoList list(dir, options);
+        REQUIRE(list.open());
+        REQUIRE(list.size() == 100);
+        while (!order.empty()) removeAndCheck(list);
+        out.str("");
+        list.removeTask();
+        REQUIRE(out.str() == "No tasks to remove!\n");
+
+        REQUIRE(list.loadFromFile(dir + "/saved.txt").loaded > 1000);
+        out.str("");
+        list.peekTask();
+        REQUIRE(out.str().rfind("Next Task: ", 0) == 0);
+    }
+
+    // a load cut short by a run that cannot be written counts the rest as rejected
+    const std::string blocked = "test_external_blocked";
+    std::filesystem::remove_all(blocked);
+    std::filesystem::create_directories(blocked + "/run-1.dat"); // where the first spill goes
+    {
+        smarttodo::ExternalToDoList list(blocked, options);
+        out.str("");
+        smarttodo::LoadStats stats = list.loadFromFile(dir + "/saved.txt");
+        REQUIRE(stats.loaded > 0);
+        REQUIRE(stats.rejected > 0);
+        REQUIRE(stats.loaded + stats.rejected > 1000);
+        REQUIRE(list.size() == stats.loaded);
+        REQUIRE(out.str().find(std::to_string(stats.rejected) + " more could not be stored") != std::string::npos);
+        std::filesystem::remove(blocked + "/run-1.dat");
+    }
+    std::filesystem::remove_all(blocked);
+    std::filesystem::remove_all(dir);
+}